@@ -5,17 +5,40 @@
 #ifndef COSTCOMPUTER_HPP
 #define COSTCOMPUTER_HPP
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 #include "PMSType.h"
+#include "PMSCostVolume.h"
+#include "PMSFeatureImage.h"
+#include "PMSSubpixelImage.h"
+#include "PMSWeightCache.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PMS_USE_AVX2    // NOLINT(cppcoreguidelines-macro-usage)
+#define PMS_USE_POPCNT  // NOLINT(cppcoreguidelines-macro-usage)
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define PMS_FORCE_INLINE inline __attribute__((always_inline))  // NOLINT(cppcoreguidelines-macro-usage)
+#elif defined(_MSC_VER)
+#define PMS_FORCE_INLINE __forceinline  // NOLINT(cppcoreguidelines-macro-usage)
+#else
+#define PMS_FORCE_INLINE inline  // NOLINT(cppcoreguidelines-macro-usage)
+#endif
 
 #define COST_PUNISH 120.0f  // NOLINT(cppcoreguidelines-macro-usage)
 
+/** \brief 单次批量聚合代价计算的最大候选平面数 */
+constexpr sint32 MAX_AGGREGATION_BATCH = 32;
+
 class CostComputer {
 public:
     /** \brief 代价计算器默认构造 */
     CostComputer() : _imgLeft(nullptr), _imgRight(nullptr), _width(0), _height(0),
-                     _patchSize(0), _minDisparity(0), _maxDisparity(0) {}
+                     _patchSize(0), _minDisparity(0), _maxDisparity(0), _costVolume(nullptr) {}
 
     /**
      * \brief 代价计算器初始化
@@ -36,6 +59,7 @@ public:
         _patchSize = patchSize;
         _minDisparity = minDisparity;
         _maxDisparity = maxDisparity;
+        _costVolume = nullptr;
     }
 
     /** \brief 代价计算器析构 */
@@ -50,6 +74,117 @@ public:
      */
     virtual float32 compute(const sint32 &x, const sint32 &y, const float32 &d) = 0;
 
+    /**
+     * \brief 设置整数视差聚合代价体，可查表的候选平面不再逐窗口聚合
+     * \param costVolume	代价体，nullptr表示不使用
+     */
+    void setCostVolume(const PMSCostVolume *costVolume) {
+        _costVolume = costVolume;
+    }
+
+protected:
+    /**
+     * \brief 从代价体查询全部候选平面的聚合代价
+     * \return 是否全部查到；任一候选无法查表时返回false，由调用者逐窗口聚合
+     */
+    bool lookupCostVolume(const sint32 &x, const sint32 &y,
+                          const DisparityPlane *planes, const sint32 &num, float32 *costs) const {
+        if (_costVolume == nullptr) {
+            return false;
+        }
+        for (sint32 k = 0; k < num; k++) {
+            if (!_costVolume->lookup(planes[k], x, y, costs[k])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** \brief 平面在窗口内的视差与视差范围的关系 */
+    enum RangeState {
+        RANGE_INSIDE,   // 处处在视差范围内
+        RANGE_PARTIAL,  // 可能部分越界
+        RANGE_OUTSIDE   // 处处超出视差范围
+    };
+
+    /**
+     * \brief 判断平面在窗口内的视差与视差范围的关系
+     * 平面为线性函数，窗口内视差的极值位于四角，四角均在视差范围同一侧之外即整个窗口越界，四角均在范围内即整个窗口在范围内
+     * 判定时保留少量余量，避免浮点舍入导致窗口内部像素的计算结果与四角不一致，余量内的情况归为可能部分越界
+     */
+    RangeState classifyRange(const DisparityPlane &p,
+                             const sint32 &xBegin, const sint32 &xEnd, const sint32 &yBegin, const sint32 &yEnd) const {
+        const float32 d00 = p.getDisparity(xBegin, yBegin);
+        const float32 d01 = p.getDisparity(xEnd, yBegin);
+        const float32 d10 = p.getDisparity(xBegin, yEnd);
+        const float32 d11 = p.getDisparity(xEnd, yEnd);
+        const float32 dMin = std::min(std::min(d00, d01), std::min(d10, d11));
+        const float32 dMax = std::max(std::max(d00, d01), std::max(d10, d11));
+        const float32 margin = 1e-4f * (std::abs(p._p._x) * float32(_width) + std::abs(p._p._y) * float32(_height) +
+                                        std::abs(p._p._z) + 1.0f);
+        if (dMin > float32(_maxDisparity) + margin || dMax < float32(_minDisparity) - margin) {
+            return RANGE_OUTSIDE;
+        }
+        if (dMin >= float32(_minDisparity) + margin && dMax <= float32(_maxDisparity) - margin) {
+            return RANGE_INSIDE;
+        }
+        return RANGE_PARTIAL;
+    }
+
+    /**
+     * \brief 统计窗口内视差超出范围的像素数
+     * 平面沿行方向为线性函数，逐行解析求出视差在范围内的列区间
+     */
+    sint32 countOutOfRange(const DisparityPlane &p,
+                           const sint32 &xBegin, const sint32 &xEnd, const sint32 &yBegin, const sint32 &yEnd) const {
+        const float32 a = p._p._x;
+        const float32 minD = float32(_minDisparity);
+        const float32 maxD = float32(_maxDisparity);
+        const sint32 rowWidth = xEnd - xBegin + 1;
+
+        sint32 count = 0;
+        for (sint32 yL = yBegin; yL <= yEnd; yL++) {
+            const float32 e = p._p._y * float32(yL) + p._p._z;
+            if (a == 0.0f) {
+                count += (e < minD || e > maxD) ? rowWidth : 0;
+                continue;
+            }
+            float32 lo = (minD - e) / a;
+            float32 hi = (maxD - e) / a;
+            if (a < 0.0f) {
+                std::swap(lo, hi);
+            }
+            lo = std::max(lo, float32(xBegin - 1));
+            hi = std::min(hi, float32(xEnd + 1));
+            const sint32 inBegin = std::max(xBegin, sint32(std::ceil(lo)));
+            const sint32 inEnd = std::min(xEnd, sint32(std::floor(hi)));
+            count += rowWidth - std::max(0, inEnd - inBegin + 1);
+        }
+        return count;
+    }
+
+#ifdef PMS_USE_AVX2
+    /**
+     * \brief 按像素序号收集8个像素的BGR颜色，每通道占8位
+     * 每像素按4字节收集，影像最后一个像素改为从前1字节开始收集再移位，避免越过影像末尾
+     */
+    __attribute__((target("avx2")))
+    __m256i gatherColorAVX2(const uint8 *imgData, const __m256i &idx) const {
+        const __m256i isLast = _mm256_cmpeq_epi32(idx, _mm256_set1_epi32(_width * _height - 1));
+        const __m256i ofs = _mm256_add_epi32(_mm256_mullo_epi32(idx, _mm256_set1_epi32(3)), isLast);
+        const __m256i v = _mm256_i32gather_epi32(reinterpret_cast<const int *>(imgData), ofs, 1);
+        return _mm256_srlv_epi32(v, _mm256_and_si256(isLast, _mm256_set1_epi32(8)));
+    }
+
+    /** \brief 8通道求和 */
+    __attribute__((target("avx2")))
+    static float32 horizontalSumAVX2(const __m256 &v) {
+        alignas(32) float32 sum[8];
+        _mm256_store_ps(sum, v);
+        return ((sum[0] + sum[1]) + (sum[2] + sum[3])) + ((sum[4] + sum[5]) + (sum[6] + sum[7]));
+    }
+#endif
+
 public:
     /** \brief 左影像数据 */
     const uint8 *_imgLeft;
@@ -66,16 +201,309 @@ public:
     /** \brief 最小最大视差 */
     sint32 _minDisparity;
     sint32 _maxDisparity;
+
+    /** \brief 整数视差聚合代价体 */
+    const PMSCostVolume *_costVolume;
+};
+
+/**
+ * \brief 代价计算器输入：一个视图计算代价所需的数据，左为本视图，右为另一视图
+ * 由传播策略交给各代价计算器构建，各代价计算器只取自身所需的部分
+ */
+struct PMSCostInput {
+    /** \brief 左右影像数据 */
+    const uint8 *_imgLeft;
+    const uint8 *_imgRight;
+    /** \brief 左右梯度数据 */
+    const PGradient *_gradLeft;
+    const PGradient *_gradRight;
+    /** \brief 左右影像的Census编码 */
+    const uint64 *_censusLeft;
+    const uint64 *_censusRight;
+
+    /** \brief 影像宽高 */
+    sint32 _width;
+    sint32 _height;
+    /** \brief 本视图的最小最大视差 */
+    sint32 _minDisparity;
+    sint32 _maxDisparity;
+
+    /** \brief 本视图的支持权值缓存 */
+    const PMSWeightCache *_weightCache;
+    /** \brief 本视图的整数视差聚合代价体 */
+    const PMSCostVolume *_costVolume;
+    /** \brief 另一视图的亚像素预插值特征 */
+    const PMSSubpixelImage *_subpixelImage;
+    /** \brief 本视图的分平面特征 */
+    const PMSFeatureImage *_featureImage;
+
+    PMSCostInput() : _imgLeft(nullptr), _imgRight(nullptr), _gradLeft(nullptr), _gradRight(nullptr),
+                     _censusLeft(nullptr), _censusRight(nullptr), _width(0), _height(0),
+                     _minDisparity(0), _maxDisparity(0), _weightCache(nullptr), _costVolume(nullptr),
+                     _subpixelImage(nullptr), _featureImage(nullptr) {}
+};
+
+/**
+ * \brief 代价聚合的公共流程：代价体查表、窗口越界预判、逐行分支限界及权值缓存聚合
+ * 以派生的代价计算器为模板参数，聚合内循环在编译期绑定到派生类的实现。派生类提供：
+ * aggregateRowKernel<Width>		累加窗口中一行像素的加权代价，按需选择SIMD实现
+ * aggregateCachedKernel			使用权值缓存聚合，可选，默认为本类的标量实现aggregateCached
+ * loadPixel、computePixel		左影像q点的匹配数据，及其与右影像同名点的单像素代价
+ * \tparam Derived	代价计算器类型
+ */
+template<typename Derived>
+class CostAggregator : public CostComputer {
+public:
+    /** \brief 默认构造 */
+    CostAggregator() : _gamma(0), _weightCache(nullptr) {}
+
+    /**
+     * \brief 带参构造，参数同CostComputer
+     * \param gamma	参数gamma值
+     */
+    CostAggregator(const uint8 *imgLeft, const uint8 *imgRight, const sint32 &width, const sint32 &height,
+                   const sint32 &patchSize, const sint32 &minDisparity, const sint32 &maxDisparity,
+                   const float32 &gamma) :
+            CostComputer(imgLeft, imgRight, width, height, patchSize, minDisparity, maxDisparity) {
+        _gamma = gamma;
+
+        // 支持权值只与颜色差(0~765)有关，预先计算查找表
+        _weightLut.resize(3 * 255 + 1);
+        for (sint32 dc = 0; dc < sint32(_weightLut.size()); dc++) {
+            _weightLut[dc] = std::exp(float32(-dc) / _gamma);
+        }
+
+        _weightCache = nullptr;
+    }
+
+    /**
+     * \brief 设置支持权值缓存，缓存区域内的像素使用缓存的权值计算聚合代价
+     * \param cache	权值缓存，nullptr表示不使用缓存
+     */
+    void setWeightCache(const PMSWeightCache *cache) {
+        _weightCache = cache;
+    }
+
+    /**
+     * \brief 计算左影像p点视差平面为p时的聚合代价值
+     * \param x		p点x坐标
+     * \param y 	p点y坐标
+     * \param p		平面参数
+     * \param bound	代价上界，部分和超过上界即停止计算，此时返回值大于上界但不是完整代价
+     * \tparam PatchSize	编译期Patch尺寸，0表示使用运行期的_patchSize
+     * \return 聚合代价值
+     */
+    template<sint32 PatchSize = 0>
+    float32 computeAggregation(const sint32 &x, const sint32 &y, const DisparityPlane &p,
+                               const float32 &bound = Invalid_Float) {
+        float32 cost = 0.0f;
+        computeAggregationBatch<PatchSize>(x, y, &p, 1, &cost, bound);
+        return cost;
+    }
+
+    /**
+     * \brief 批量计算左影像p点在多个候选平面下的聚合代价值
+     * 支持窗口的权值及左影像数据只与p点有关，遍历窗口时只计算一次，由所有候选平面共享
+     * 给定上界时按分支限界计算：每行累加后剔除部分和已超过上界的候选；
+     * 平面为线性函数，若窗口四角视差均在视差范围同一侧之外，则整个窗口越界，代价直接取惩罚值之和；
+     * 否则按行解析统计越界像素数，仅越界部分的惩罚已超过上界的候选不再聚合
+     * \param x		p点x坐标
+     * \param y 	p点y坐标
+     * \param planes	候选平面数组
+     * \param num		候选平面数量
+     * \param costs	输出，各候选平面的聚合代价值；被剪枝的候选输出值大于上界但不是完整代价
+     * \param bound	代价上界，默认无上界
+     * \tparam PatchSize	编译期Patch尺寸，0表示使用运行期的_patchSize
+     * \return 被剪枝（提前终止或直接剔除）的候选数量
+     */
+    template<sint32 PatchSize = 0>
+    sint32 computeAggregationBatch(const sint32 &x, const sint32 &y,
+                                   const DisparityPlane *planes, const sint32 &num, float32 *costs,
+                                   const float32 &bound = Invalid_Float) {
+        if (num > MAX_AGGREGATION_BATCH) {
+            sint32 numPruned = 0;
+            for (sint32 k = 0; k < num; k += MAX_AGGREGATION_BATCH) {
+                numPruned += computeAggregationBatch<PatchSize>(x, y, planes + k,
+                                                                std::min(num - k, MAX_AGGREGATION_BATCH),
+                                                                costs + k, bound);
+            }
+            return numPruned;
+        }
+
+        // 候选平面均可查表时不再聚合
+        if (lookupCostVolume(x, y, planes, num, costs)) {
+            return 0;
+        }
+
+        const sint32 patHalf = (PatchSize > 0 ? PatchSize : _patchSize) / 2;
+        const uint8 *colP = _imgLeft + (y * _width + x) * 3;
+        const sint32 xBegin = std::max(x - patHalf, 0);
+        const sint32 xEnd = std::min(x + patHalf, _width - 1);
+        const sint32 yBegin = std::max(y - patHalf, 0);
+        const sint32 yEnd = std::min(y + patHalf, _height - 1);
+        // 窗口未被左右边界截断时，行宽为编译期常量
+        const bool isFullRow = (xBegin == x - patHalf) && (xEnd == x + patHalf);
+        const float32 punishAll = float32((xEnd - xBegin + 1) * (yEnd - yBegin + 1)) * COST_PUNISH;
+
+        // 参与计算的候选平面
+        DisparityPlane activePlanes[MAX_AGGREGATION_BATCH];
+        float32 activeCosts[MAX_AGGREGATION_BATCH];
+        sint32 activeIndices[MAX_AGGREGATION_BATCH];
+        sint32 numActive = 0;
+        sint32 numPruned = 0;
+        for (sint32 k = 0; k < num; k++) {
+            const RangeState range = classifyRange(planes[k], xBegin, xEnd, yBegin, yEnd);
+            if (range == RANGE_OUTSIDE) {
+                costs[k] = punishAll;
+                numPruned += (punishAll > bound) ? 1 : 0;
+                continue;
+            }
+            // 仅越界部分的惩罚已超过上界时不再聚合
+            if (range == RANGE_PARTIAL && bound != Invalid_Float) {
+                const float32 punish = float32(countOutOfRange(planes[k], xBegin, xEnd, yBegin, yEnd)) * COST_PUNISH;
+                if (punish > bound) {
+                    costs[k] = punish;
+                    numPruned++;
+                    continue;
+                }
+            }
+            activePlanes[numActive] = planes[k];
+            activeCosts[numActive] = 0.0f;
+            activeIndices[numActive] = k;
+            numActive++;
+        }
+
+        if (_weightCache != nullptr && _weightCache->contains(x, y)) {
+            numPruned += derived().aggregateCachedKernel(x, y, xBegin, xEnd, yBegin, yEnd,
+                                                         activePlanes, numActive, activeCosts, bound);
+            for (sint32 k = 0; k < numActive; k++) {
+                costs[activeIndices[k]] = activeCosts[k];
+            }
+            return numPruned;
+        }
+
+        for (sint32 yL = yBegin; yL <= yEnd && numActive > 0; yL++) {
+            if (isFullRow) {
+                derived().template aggregateRowKernel<PatchSize>(yL, xBegin, xEnd, colP,
+                                                                 activePlanes, numActive, activeCosts);
+            } else {
+                derived().template aggregateRowKernel<0>(yL, xBegin, xEnd, colP, activePlanes, numActive, activeCosts);
+            }
+
+            // 剔除部分和已超过上界的候选，其余候选保持原顺序
+            if (bound == Invalid_Float || yL == yEnd) {
+                continue;
+            }
+            sint32 n = 0;
+            for (sint32 k = 0; k < numActive; k++) {
+                if (activeCosts[k] > bound) {
+                    costs[activeIndices[k]] = activeCosts[k];
+                    numPruned++;
+                    continue;
+                }
+                activePlanes[n] = activePlanes[k];
+                activeCosts[n] = activeCosts[k];
+                activeIndices[n] = activeIndices[k];
+                n++;
+            }
+            numActive = n;
+        }
+
+        for (sint32 k = 0; k < numActive; k++) {
+            costs[activeIndices[k]] = activeCosts[k];
+        }
+        return numPruned;
+    }
+
+protected:
+    /**
+     * \brief 使用权值缓存累加窗口内各候选平面的代价（标量实现）
+     * 只遍历缓存中保留的像素；越界惩罚按行解析计入，被舍弃的低权值像素同样受罚
+     * \return 被剪枝的候选数量
+     */
+    sint32 aggregateCached(const sint32 &x, const sint32 &y,
+                           const sint32 &xBegin, const sint32 &xEnd, const sint32 &yBegin, const sint32 &yEnd,
+                           const DisparityPlane *planes, const sint32 &num, float32 *costs, const float32 &bound) {
+        bool alive[MAX_AGGREGATION_BATCH];
+        sint32 numAlive = 0;
+        sint32 numPruned = 0;
+        for (sint32 k = 0; k < num; k++) {
+            costs[k] = float32(countOutOfRange(planes[k], xBegin, xEnd, yBegin, yEnd)) * COST_PUNISH;
+            alive[k] = costs[k] <= bound;
+            numAlive += alive[k] ? 1 : 0;
+            numPruned += alive[k] ? 0 : 1;
+        }
+
+        const sint32 patchSize = _weightCache->getPatchSize();
+        const sint32 patHalf = patchSize / 2;
+        const uint8 *window = _weightCache->getWindow(x, y);
+        for (sint32 yL = yBegin; yL <= yEnd && numAlive > 0; yL++) {
+            // 每处理完一行检查一次上界
+            if (yL > yBegin && bound != Invalid_Float) {
+                for (sint32 k = 0; k < num; k++) {
+                    if (alive[k] && costs[k] > bound) {
+                        alive[k] = false;
+                        numAlive--;
+                        numPruned++;
+                    }
+                }
+            }
+
+            const uint8 *weights = window + (yL - y + patHalf) * patchSize + patHalf;
+            for (sint32 xL = xBegin; xL <= xEnd; xL++) {
+                if (weights[xL - x] == 0) {
+                    continue;
+                }
+                const auto pixelQ = derived().loadPixel(xL, yL);
+                const float32 w = PMSWeightCache::dequantize(weights[xL - x]);
+
+                for (sint32 k = 0; k < num; k++) {
+                    if (!alive[k]) {
+                        continue;
+                    }
+                    const float32 d = planes[k].getDisparity(xL, yL);
+                    if (d < float32(_minDisparity) || d > float32(_maxDisparity)) {
+                        continue;
+                    }
+                    costs[k] += w * derived().computePixel(pixelQ, yL, float32(xL) - d);
+                }
+            }
+        }
+        return numPruned;
+    }
+
+    /** \brief 使用权值缓存累加窗口内各候选平面的代价，派生类可替换为SIMD实现 */
+    sint32 aggregateCachedKernel(const sint32 &x, const sint32 &y,
+                                 const sint32 &xBegin, const sint32 &xEnd, const sint32 &yBegin, const sint32 &yEnd,
+                                 const DisparityPlane *planes, const sint32 &num, float32 *costs,
+                                 const float32 &bound) {
+        return aggregateCached(x, y, xBegin, xEnd, yBegin, yEnd, planes, num, costs, bound);
+    }
+
+    /** \brief 参数gamma */
+    float32 _gamma;
+    /** \brief 支持权值查找表，下标为颜色差 */
+    std::vector<float32> _weightLut;
+    /** \brief 支持权值缓存 */
+    const PMSWeightCache *_weightCache;
+
+private:
+    Derived &derived() {
+        return static_cast<Derived &>(*this);
+    }
 };
 
 /**
  * \brief 代价计算器：PatchMatchStereo原文代价计算器
  */
-class CostComputerPMS : public CostComputer {
+class CostComputerPMS final : public CostAggregator<CostComputerPMS> {
+    friend class CostAggregator<CostComputerPMS>;
+
 public:
     /** \brief PMS代价计算器默认构造 */
     CostComputerPMS() : _gradLeft(nullptr), _gradRight(nullptr),
-                        _gamma(0), _alpha(0), _tauCol(0), _tauGrad(0) {};
+                        _alpha(0), _tauCol(0), _tauGrad(0), _isUseSimd(false),
+                        _subpixelImage(nullptr), _featureImage(nullptr) {};
 
     /**
      * \brief PMS代价计算器带参构造
@@ -100,13 +528,69 @@ public:
                     const sint32 &minDisparity, const sint32 &maxDisparity,
                     const float32 &gamma, const float32 &alpha,
                     const float32 &tauCol, const float32 tauGrad) :
-            CostComputer(imgLeft, imgRight, width, height, patchSize, minDisparity, maxDisparity) {
+            CostAggregator(imgLeft, imgRight, width, height, patchSize, minDisparity, maxDisparity, gamma) {
         _gradLeft = gradLeft;
         _gradRight = gradRight;
-        _gamma = gamma;
         _alpha = alpha;
         _tauCol = tauCol;
         _tauGrad = tauGrad;
+        _isUseSimd = false;
+        _subpixelImage = nullptr;
+        _featureImage = nullptr;
+    }
+
+    /**
+     * \brief 由视图输入构建代价计算器，使用影像、梯度及其加速结构
+     * \param option	算法参数，取Patch尺寸、代价参数及是否使用SIMD
+     * \param input		视图输入
+     */
+    static CostComputerPMS create(const PMSOption &option, const PMSCostInput &input) {
+        CostComputerPMS costCpt(input._imgLeft, input._imgRight, input._gradLeft, input._gradRight,
+                                input._width, input._height, option._patchSize,
+                                input._minDisparity, input._maxDisparity,
+                                option._gamma, option._alpha, option._tauCol, option._tauGrad);
+        costCpt.setUseSimd(option._isUseSimd);
+        costCpt.setWeightCache(input._weightCache);
+        costCpt.setCostVolume(input._costVolume);
+        costCpt.setSubpixelImage(input._subpixelImage);
+        costCpt.setFeatureImage(input._featureImage);
+        return costCpt;
+    }
+
+    /**
+     * \brief 设置是否使用SIMD聚合核，仅在CPU支持AVX2时生效
+     * \param isUseSimd	是否使用SIMD
+     * \return 实际是否使用SIMD
+     */
+    bool setUseSimd(const bool &isUseSimd) {
+        _isUseSimd = isUseSimd && isSimdSupported();
+        return _isUseSimd;
+    }
+
+    /**
+     * \brief 设置右影像的亚像素预插值特征，同名点取最近的亚像素位置，不再逐点插值
+     * \param subpixelImage	亚像素特征，nullptr表示逐点插值
+     */
+    void setSubpixelImage(const PMSSubpixelImage *subpixelImage) {
+        _subpixelImage = subpixelImage;
+    }
+
+    /**
+     * \brief 设置左影像的分平面特征，窗口内像素的颜色及梯度按行连续读取
+     * \param featureImage	左影像特征，nullptr表示从原始影像及梯度读取
+     */
+    void setFeatureImage(const PMSFeatureImage *featureImage) {
+        _featureImage = featureImage;
+    }
+
+    /** \brief 当前CPU是否支持AVX2聚合核 */
+    static bool isSimdSupported() {
+#ifdef PMS_USE_AVX2
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
     }
 
 
@@ -118,13 +602,26 @@ public:
      * \return 代价值
      */
     float32 compute(const sint32 &x, const sint32 &y, const float32 &d) override {
-        const float32 xr = float32(x) - d;
+        return compute(getColor(_imgLeft, x, y), getGradient(_gradLeft, x, y), y, float32(x) - d);
+    }
+
+    /**
+     * \brief 已知左影像q点颜色和梯度时，计算其与右影像同名点xr的代价值，未做边界判定
+     * \param colQL	q点颜色
+     * \param gradQL	q点梯度
+     * \param y		q点y坐标
+     * \param xr		右影像同名点x坐标
+     * \return 代价值
+     */
+    float32 compute(const PColor &colQL, const PGradient &gradQL, const sint32 &y, const float32 &xr) {
         if (xr < 0.0f || xr >= float32(_width)) {
             return (1.0f - _alpha) * _tauCol + _alpha * _tauGrad;
         }
+        if (_subpixelImage != nullptr) {
+            return computeSubpixel(colQL, gradQL, _subpixelImage->sample(xr, y));
+        }
 
         // 颜色空间距离
-        const auto colQL = getColor(_imgLeft, x, y);
         const auto colQR = getColor(_imgRight, xr, y);
         const auto dc = std::min(
                 std::abs(float32(colQL._b) - colQR._x) +
@@ -134,7 +631,6 @@ public:
         );
 
         // 梯度空间距离
-        const auto gradQL = getGradient(_gradLeft, x, y);
         const auto gradQR = getGradient(_gradRight, xr, y);
         const auto dg = std::min(
                 std::abs(float32(gradQL._x) - gradQR._x) +
@@ -146,47 +642,27 @@ public:
         return (1 - _alpha) * dc + _alpha * dg;
     }
 
-
     /**
-     * \brief 计算左影像p点视差平面为p时的聚合代价值
-     * \param x		p点x坐标
-     * \param y 	p点y坐标
-     * \param p		平面参数
-     * \return 聚合代价值
+     * \brief 已知左影像q点颜色和梯度时，计算其与右影像同名点亚像素特征的代价值
+     * \param colQL	q点颜色
+     * \param gradQL	q点梯度
+     * \param f		同名点的亚像素特征
+     * \return 代价值
      */
-    float32 computeAggregation(const sint32 &x, const sint32 &y, const DisparityPlane &p) {
-        const sint32 patHalf = _patchSize / 2;
-        const PColor &colP = getColor(_imgLeft, x, y);
-
-        float32 cost = 0.0f;
-        for (sint32 r = -patHalf; r <= patHalf; r++) {
-            sint32 yL = y + r;
-            for (sint32 c = -patHalf; c <= patHalf; c++) {
-                sint32 xL = x + c;
-
-                if (yL < 0 || yL >= _height || xL < 0 || xL >= _width) {
-                    continue;
-                }
-                // 计算视差值
-                const float32 d = p.getDisparity(xL, yL);
-
-                if (d < float32(_minDisparity) || d > float32(_maxDisparity)) {
-                    cost += COST_PUNISH;
-                    continue;
-                }
-
-                const PColor &colQ = getColor(_imgLeft, xL, yL);
-                const auto dc = std::abs(colP._r - colQ._r) +
-                                std::abs(colP._g - colQ._g) +
-                                std::abs(colP._b - colQ._b);
-
-                const auto w = std::exp(float32(-dc) / _gamma);
-
-                cost += w * compute(xL, yL, d);
-            }
-        }
-
-        return cost;
+    float32 computeSubpixel(const PColor &colQL, const PGradient &gradQL, const PMSSubpixelFeature &f) const {
+        const float32 scale = 1.0f / float32(PMSSubpixelImage::FIXED_SCALE);
+        const auto dc = std::min(
+                std::abs(float32(colQL._b) - float32(f._b) * scale) +
+                std::abs(float32(colQL._g) - float32(f._g) * scale) +
+                std::abs(float32(colQL._r) - float32(f._r) * scale),
+                _tauCol
+        );
+        const auto dg = std::min(
+                std::abs(float32(gradQL._x) - float32(f._gx) * scale) +
+                std::abs(float32(gradQL._y) - float32(f._gy) * scale),
+                _tauGrad
+        );
+        return (1 - _alpha) * dc + _alpha * dg;
     }
 
     /**
@@ -236,20 +712,902 @@ public:
     }
 
 private:
+    /** \brief 左影像q点的颜色和梯度 */
+    struct Pixel {
+        PColor _color;
+        PGradient _grad;
+    };
+
+    /** \brief 读取左影像q点的颜色和梯度 */
+    PMS_FORCE_INLINE Pixel loadPixel(const sint32 &x, const sint32 &y) {
+        return {getColor(_imgLeft, x, y), getGradient(_gradLeft, x, y)};
+    }
+
+    /** \brief 计算左影像q点与右影像同名点xr的代价值 */
+    PMS_FORCE_INLINE float32 computePixel(const Pixel &pixelQ, const sint32 &y, const float32 &xr) {
+        return compute(pixelQ._color, pixelQ._grad, y, xr);
+    }
+
+    /** \brief 累加窗口中一行像素在各候选平面下的加权代价，CPU支持时使用AVX2实现 */
+    template<sint32 Width>
+    PMS_FORCE_INLINE void aggregateRowKernel(const sint32 &yL, const sint32 &xBegin, const sint32 &xEnd,
+                                             const uint8 *colP,
+                                             const DisparityPlane *planes, const sint32 &num, float32 *costs) {
+#ifdef PMS_USE_AVX2
+        if (_isUseSimd) {
+            aggregateRowAVX2<Width>(yL, xBegin, xEnd, colP, planes, num, costs);
+            return;
+        }
+#endif
+        aggregateRow<Width>(yL, xBegin, xEnd, colP, planes, num, costs);
+    }
+
+    /** \brief 使用权值缓存累加窗口内各候选平面的代价，CPU支持时使用AVX2实现 */
+    sint32 aggregateCachedKernel(const sint32 &x, const sint32 &y,
+                                 const sint32 &xBegin, const sint32 &xEnd, const sint32 &yBegin, const sint32 &yEnd,
+                                 const DisparityPlane *planes, const sint32 &num, float32 *costs,
+                                 const float32 &bound) {
+#ifdef PMS_USE_AVX2
+        if (_isUseSimd) {
+            return aggregateCachedAVX2(x, y, xBegin, xEnd, yBegin, yEnd, planes, num, costs, bound);
+        }
+#endif
+        return aggregateCached(x, y, xBegin, xEnd, yBegin, yEnd, planes, num, costs, bound);
+    }
+
+    /**
+     * \brief 累加窗口中一行像素在各候选平面下的加权代价（标量参考实现）
+     * \param yL		行号
+     * \param xBegin	起始列号
+     * \param xEnd		结束列号（含）
+     * \param colP		中心像素p的颜色
+     * \param planes	候选平面数组
+     * \param num		候选平面数量
+     * \param costs	各候选平面的累加代价值
+     * \tparam Width	编译期行宽，0表示由xBegin、xEnd决定
+     */
+    template<sint32 Width>
+    void aggregateRow(const sint32 &yL, const sint32 &xBegin, const sint32 &xEnd, const uint8 *colP,
+                      const DisparityPlane *planes, const sint32 &num, float32 *costs) {
+        // 有分平面特征时按行连续读取左影像颜色及梯度
+        const sint16 *feature[PMSFeatureImage::NUM_CHANNELS] = {};
+        if (_featureImage != nullptr) {
+            for (sint32 c = 0; c < PMSFeatureImage::NUM_CHANNELS; c++) {
+                feature[c] = _featureImage->getRow(c, yL);
+            }
+        }
+
+        const sint32 count = Width > 0 ? Width : xEnd - xBegin + 1;
+        for (sint32 i = 0; i < count; i++) {
+            const sint32 xL = xBegin + i;
+            const PColor colQ = (_featureImage != nullptr) ?
+                                PColor(uint8(feature[PMSFeatureImage::CHANNEL_B][xL]),
+                                       uint8(feature[PMSFeatureImage::CHANNEL_G][xL]),
+                                       uint8(feature[PMSFeatureImage::CHANNEL_R][xL])) :
+                                getColor(_imgLeft, xL, yL);
+            const PGradient gradQ = (_featureImage != nullptr) ?
+                                    PGradient(feature[PMSFeatureImage::CHANNEL_GX][xL],
+                                              feature[PMSFeatureImage::CHANNEL_GY][xL]) :
+                                    getGradient(_gradLeft, xL, yL);
+            const auto dc = std::abs(colP[2] - colQ._r) +
+                            std::abs(colP[1] - colQ._g) +
+                            std::abs(colP[0] - colQ._b);
+
+            const auto w = _weightLut[dc];
+
+            for (sint32 k = 0; k < num; k++) {
+                // 计算视差值
+                const float32 d = planes[k].getDisparity(xL, yL);
+
+                if (d < float32(_minDisparity) || d > float32(_maxDisparity)) {
+                    costs[k] += COST_PUNISH;
+                    continue;
+                }
+
+                costs[k] += w * compute(colQ, gradQ, yL, float32(xL) - d);
+            }
+        }
+    }
+
+#ifdef PMS_USE_AVX2
+    /**
+     * \brief 计算8个左影像像素与右影像同名点的代价（AVX2实现，与compute逐像素运算一致）
+     * \param rowIdx	各通道所在行首像素的序号
+     * \param xr		右影像同名点x坐标
+     * \param bL gL rL	左影像像素颜色
+     * \param gxL gyL	左影像像素梯度
+     * \return 代价值，同名点越界的通道为越界代价
+     */
+    __attribute__((target("avx2")))
+    __m256 computeAVX2(const __m256i &rowIdx, const __m256 &xr,
+                       const __m256 &bL, const __m256 &gL, const __m256 &rL,
+                       const __m256 &gxL, const __m256 &gyL) const {
+        const __m256i byteMask = _mm256_set1_epi32(0xff);
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        const __m256 zero = _mm256_setzero_ps();
+
+        // 越界通道钳制后采样，结果再替换为越界代价
+        const __m256 outImg = _mm256_or_ps(_mm256_cmp_ps(xr, zero, _CMP_LT_OQ),
+                                           _mm256_cmp_ps(xr, _mm256_set1_ps(float32(_width)), _CMP_GE_OQ));
+        const __m256 xrc = _mm256_min_ps(_mm256_max_ps(xr, zero), _mm256_set1_ps(float32(_width - 1)));
+        const __m256i x1 = _mm256_cvttps_epi32(xrc);
+        const __m256i x2 = _mm256_min_epi32(_mm256_add_epi32(x1, _mm256_set1_epi32(1)),
+                                            _mm256_set1_epi32(_width - 1));
+        const __m256 ofs = _mm256_sub_ps(xrc, _mm256_cvtepi32_ps(x1));
+        const __m256 ofsInv = _mm256_sub_ps(_mm256_set1_ps(1.0f), ofs);
+        const __m256i idx1 = _mm256_add_epi32(rowIdx, x1);
+        const __m256i idx2 = _mm256_add_epi32(rowIdx, x2);
+
+        // 颜色空间距离
+        const __m256i col1 = gatherColorAVX2(_imgRight, idx1);
+        const __m256i col2 = gatherColorAVX2(_imgRight, idx2);
+        __m256 dc = zero;
+        for (sint32 n = 0; n < 3; n++) {
+            const __m256 c1 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(col1, 8 * n), byteMask));
+            const __m256 c2 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(col2, 8 * n), byteMask));
+            const __m256 colR = _mm256_add_ps(_mm256_mul_ps(ofsInv, c1), _mm256_mul_ps(ofs, c2));
+            const __m256 colL = (n == 0) ? bL : ((n == 1) ? gL : rL);
+            dc = _mm256_add_ps(dc, _mm256_and_ps(_mm256_sub_ps(colL, colR), absMask));
+        }
+        dc = _mm256_min_ps(dc, _mm256_set1_ps(_tauCol));
+
+        // 梯度空间距离
+        const auto *gradR = reinterpret_cast<const int *>(_gradRight);
+        const __m256i grad1 = _mm256_i32gather_epi32(gradR, idx1, 4);
+        const __m256i grad2 = _mm256_i32gather_epi32(gradR, idx2, 4);
+        const __m256 gxR = _mm256_add_ps(
+                _mm256_mul_ps(ofsInv, _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(grad1, 16), 16))),
+                _mm256_mul_ps(ofs, _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(grad2, 16), 16))));
+        const __m256 gyR = _mm256_add_ps(
+                _mm256_mul_ps(ofsInv, _mm256_cvtepi32_ps(_mm256_srai_epi32(grad1, 16))),
+                _mm256_mul_ps(ofs, _mm256_cvtepi32_ps(_mm256_srai_epi32(grad2, 16))));
+        const __m256 dg = _mm256_min_ps(_mm256_add_ps(_mm256_and_ps(_mm256_sub_ps(gxL, gxR), absMask),
+                                                      _mm256_and_ps(_mm256_sub_ps(gyL, gyR), absMask)),
+                                        _mm256_set1_ps(_tauGrad));
+
+        // 代价值
+        const __m256 cost = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(1 - _alpha), dc),
+                                          _mm256_mul_ps(_mm256_set1_ps(_alpha), dg));
+        return _mm256_blendv_ps(cost, _mm256_set1_ps((1.0f - _alpha) * _tauCol + _alpha * _tauGrad), outImg);
+    }
+
+    /** \brief 32位整数的低16位（有符号）转换为浮点 */
+    __attribute__((target("avx2")))
+    static __m256 lowToFloatAVX2(const __m256i &v) {
+        return _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16));
+    }
+
+    /** \brief 32位整数的高16位（有符号）转换为浮点 */
+    __attribute__((target("avx2")))
+    static __m256 highToFloatAVX2(const __m256i &v) {
+        return _mm256_cvtepi32_ps(_mm256_srai_epi32(v, 16));
+    }
+
+    /**
+     * \brief 计算8个左影像像素与右影像同名点亚像素特征的代价（AVX2实现，与computeSubpixel逐像素运算一致）
+     * 每个特征按3个32位整数收集：(b,g)、(r,gx)、(gy,保留)。收集下标相对于基准行，
+     * 只包含窗口内的行偏移及行内位置，不随影像尺寸增大而溢出
+     * \param subBase	基准行首特征
+     * \param subRowOfs	各通道所在行首特征相对于基准行首的序号
+     * \param xr		右影像同名点x坐标
+     * \param bL gL rL	左影像像素颜色
+     * \param gxL gyL	左影像像素梯度
+     * \return 代价值，同名点越界的通道为越界代价
+     */
+    __attribute__((target("avx2")))
+    __m256 computeSubpixelAVX2(const PMSSubpixelFeature *subBase, const __m256i &subRowOfs, const __m256 &xr,
+                               const __m256 &bL, const __m256 &gL, const __m256 &rL,
+                               const __m256 &gxL, const __m256 &gyL) const {
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 scale = _mm256_set1_ps(1.0f / float32(PMSSubpixelImage::FIXED_SCALE));
+
+        // 越界通道钳制后采样，结果再替换为越界代价；坐标取最近的亚像素位置
+        const __m256 outImg = _mm256_or_ps(_mm256_cmp_ps(xr, zero, _CMP_LT_OQ),
+                                           _mm256_cmp_ps(xr, _mm256_set1_ps(float32(_width)), _CMP_GE_OQ));
+        const __m256 xrc = _mm256_min_ps(_mm256_max_ps(xr, zero), _mm256_set1_ps(float32(_width - 1)));
+        const __m256i sub = _mm256_cvttps_epi32(_mm256_add_ps(
+                _mm256_mul_ps(xrc, _mm256_set1_ps(float32(_subpixelImage->getStep()))), _mm256_set1_ps(0.5f)));
+        const __m256i idx = _mm256_slli_epi32(_mm256_add_epi32(subRowOfs, sub), 2);
+
+        const auto *features = reinterpret_cast<const int *>(subBase);
+        const __m256i f0 = _mm256_i32gather_epi32(features, idx, 4);
+        const __m256i f1 = _mm256_i32gather_epi32(features + 1, idx, 4);
+        const __m256i f2 = _mm256_i32gather_epi32(features + 2, idx, 4);
+
+        // 颜色空间距离
+        __m256 dc = _mm256_and_ps(_mm256_sub_ps(bL, _mm256_mul_ps(lowToFloatAVX2(f0), scale)), absMask);
+        dc = _mm256_add_ps(dc, _mm256_and_ps(_mm256_sub_ps(gL, _mm256_mul_ps(highToFloatAVX2(f0), scale)), absMask));
+        dc = _mm256_add_ps(dc, _mm256_and_ps(_mm256_sub_ps(rL, _mm256_mul_ps(lowToFloatAVX2(f1), scale)), absMask));
+        dc = _mm256_min_ps(dc, _mm256_set1_ps(_tauCol));
+
+        // 梯度空间距离
+        const __m256 dg = _mm256_min_ps(
+                _mm256_add_ps(_mm256_and_ps(_mm256_sub_ps(gxL, _mm256_mul_ps(highToFloatAVX2(f1), scale)), absMask),
+                              _mm256_and_ps(_mm256_sub_ps(gyL, _mm256_mul_ps(lowToFloatAVX2(f2), scale)), absMask)),
+                _mm256_set1_ps(_tauGrad));
+
+        // 代价值
+        const __m256 cost = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(1 - _alpha), dc),
+                                          _mm256_mul_ps(_mm256_set1_ps(_alpha), dg));
+        return _mm256_blendv_ps(cost, _mm256_set1_ps((1.0f - _alpha) * _tauCol + _alpha * _tauGrad), outImg);
+    }
+
+    /** \brief 连续读取8个16位特征并扩展为32位整数 */
+    __attribute__((target("avx2")))
+    static __m256i loadFeatureAVX2(const sint16 *feature) {
+        return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(feature)));
+    }
+
+    /**
+     * \brief 累加窗口中一行像素在各候选平面下的加权代价（AVX2实现，每次处理8个像素）
+     * 与标量实现逐像素运算一致，仅累加顺序不同
+     */
+    template<sint32 Width>
+    __attribute__((target("avx2")))
+    void aggregateRowAVX2(const sint32 &yL, const sint32 &xBegin, const sint32 &xEnd, const uint8 *colP,
+                          const DisparityPlane *planes, const sint32 &num, float32 *costs) {
+        const auto *gradRowL = reinterpret_cast<const int *>(_gradLeft + yL * _width);
+        // 有分平面特征时每个通道连续读取8个像素，尾部不足8个时读入边界扩展部分，由valid屏蔽
+        const bool isFeature = (_featureImage != nullptr);
+        const sint16 *rowB = isFeature ? _featureImage->getRow(PMSFeatureImage::CHANNEL_B, yL) : nullptr;
+        const sint16 *rowG = isFeature ? _featureImage->getRow(PMSFeatureImage::CHANNEL_G, yL) : nullptr;
+        const sint16 *rowR = isFeature ? _featureImage->getRow(PMSFeatureImage::CHANNEL_R, yL) : nullptr;
+        const sint16 *rowGx = isFeature ? _featureImage->getRow(PMSFeatureImage::CHANNEL_GX, yL) : nullptr;
+        const sint16 *rowGy = isFeature ? _featureImage->getRow(PMSFeatureImage::CHANNEL_GY, yL) : nullptr;
+
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i byteMask = _mm256_set1_epi32(0xff);
+        const __m256i rowIdx = _mm256_set1_epi32(yL * _width);
+        const PMSSubpixelFeature *subRow = (_subpixelImage != nullptr) ?
+                                           _subpixelImage->getData() + uint64(yL) * _subpixelImage->getRowSize() :
+                                           nullptr;
+        const __m256i zeroI = _mm256_setzero_si256();
+        const __m256i colPb = _mm256_set1_epi32(colP[0]);
+        const __m256i colPg = _mm256_set1_epi32(colP[1]);
+        const __m256i colPr = _mm256_set1_epi32(colP[2]);
+
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 minD = _mm256_set1_ps(float32(_minDisparity));
+        const __m256 maxD = _mm256_set1_ps(float32(_maxDisparity));
+        const __m256 yF = _mm256_set1_ps(float32(yL));
+        const __m256 punish = _mm256_set1_ps(COST_PUNISH);
+
+        __m256 acc[MAX_AGGREGATION_BATCH];
+        for (sint32 k = 0; k < num; k++) {
+            acc[k] = zero;
+        }
+
+        const sint32 count = Width > 0 ? Width : xEnd - xBegin + 1;
+        for (sint32 i = 0; i < count; i += 8) {
+            const sint32 x0 = xBegin + i;
+            // 超出本行窗口范围的通道不参与累加，其坐标钳制到窗口内以保证访存合法
+            __m256i xi = _mm256_add_epi32(_mm256_set1_epi32(x0), lane);
+            const __m256 valid = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(xEnd + 1), xi));
+            xi = _mm256_min_epi32(xi, _mm256_set1_epi32(xEnd));
+            const __m256 xF = _mm256_cvtepi32_ps(xi);
+
+            // 左影像q点颜色、梯度及支持权值，由所有候选平面共享
+            __m256i bQ, gQ, rQ, gxQ, gyQ;
+            if (isFeature) {
+                bQ = loadFeatureAVX2(rowB + x0);
+                gQ = loadFeatureAVX2(rowG + x0);
+                rQ = loadFeatureAVX2(rowR + x0);
+                gxQ = loadFeatureAVX2(rowGx + x0);
+                gyQ = loadFeatureAVX2(rowGy + x0);
+            } else {
+                const __m256i colQ = gatherColorAVX2(_imgLeft, _mm256_add_epi32(rowIdx, xi));
+                bQ = _mm256_and_si256(colQ, byteMask);
+                gQ = _mm256_and_si256(_mm256_srli_epi32(colQ, 8), byteMask);
+                rQ = _mm256_and_si256(_mm256_srli_epi32(colQ, 16), byteMask);
+                const __m256i gradQ = _mm256_i32gather_epi32(gradRowL, xi, 4);
+                gxQ = _mm256_srai_epi32(_mm256_slli_epi32(gradQ, 16), 16);
+                gyQ = _mm256_srai_epi32(gradQ, 16);
+            }
+            const __m256i dcw = _mm256_add_epi32(_mm256_add_epi32(
+                    _mm256_abs_epi32(_mm256_sub_epi32(colPr, rQ)),
+                    _mm256_abs_epi32(_mm256_sub_epi32(colPg, gQ))),
+                    _mm256_abs_epi32(_mm256_sub_epi32(colPb, bQ)));
+            const __m256 w = _mm256_and_ps(_mm256_i32gather_ps(_weightLut.data(), dcw, 4), valid);
+
+            const __m256 bL = _mm256_cvtepi32_ps(bQ);
+            const __m256 gL = _mm256_cvtepi32_ps(gQ);
+            const __m256 rL = _mm256_cvtepi32_ps(rQ);
+            const __m256 gxL = _mm256_cvtepi32_ps(gxQ);
+            const __m256 gyL = _mm256_cvtepi32_ps(gyQ);
+
+            for (sint32 k = 0; k < num; k++) {
+                // 计算视差值
+                const auto &p = planes[k]._p;
+                const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p._x), xF),
+                                                             _mm256_mul_ps(_mm256_set1_ps(p._y), yF)),
+                                               _mm256_set1_ps(p._z));
+                const __m256 outDisp = _mm256_or_ps(_mm256_cmp_ps(d, minD, _CMP_LT_OQ),
+                                                    _mm256_cmp_ps(d, maxD, _CMP_GT_OQ));
+
+                const __m256 xr = _mm256_sub_ps(xF, d);
+                const __m256 cost = (_subpixelImage != nullptr) ?
+                                    computeSubpixelAVX2(subRow, zeroI, xr, bL, gL, rL, gxL, gyL) :
+                                    computeAVX2(rowIdx, xr, bL, gL, rL, gxL, gyL);
+                const __m256 weighted = _mm256_blendv_ps(_mm256_mul_ps(w, cost), punish, outDisp);
+                acc[k] = _mm256_add_ps(acc[k], _mm256_and_ps(weighted, valid));
+            }
+        }
+
+        for (sint32 k = 0; k < num; k++) {
+            costs[k] += horizontalSumAVX2(acc[k]);
+        }
+    }
+
+    /** \brief 剔除代价（越界惩罚与累加值之和）已超过上界的候选 */
+    __attribute__((target("avx2")))
+    static void pruneCachedAVX2(const float32 *costs, const __m256 *acc, const sint32 &num, const float32 &bound,
+                                bool *alive, sint32 &numAlive, sint32 &numPruned) {
+        if (bound == Invalid_Float) {
+            return;
+        }
+        for (sint32 k = 0; k < num; k++) {
+            if (alive[k] && costs[k] + horizontalSumAVX2(acc[k]) > bound) {
+                alive[k] = false;
+                numAlive--;
+                numPruned++;
+            }
+        }
+    }
+
+    /**
+     * \brief 累加8个缓存像素在各候选平面下的加权代价（AVX2实现）
+     * \param xs ys ws	8个像素的坐标及量化权值，32字节对齐，补齐的通道权值为0
+     * \param yBase		像素所在窗口的首行，亚像素特征相对该行收集
+     * \param alive		各候选平面是否仍需累加
+     * \param acc		各候选平面的累加值
+     */
+    __attribute__((target("avx2")))
+    void accumulateCachedAVX2(const sint32 *xs, const sint32 *ys, const sint32 *ws, const sint32 &yBase,
+                              const DisparityPlane *planes, const bool *alive, const sint32 &num, __m256 *acc) {
+        const __m256i xi = _mm256_load_si256(reinterpret_cast<const __m256i *>(xs));
+        const __m256i yi = _mm256_load_si256(reinterpret_cast<const __m256i *>(ys));
+        const __m256i wq = _mm256_load_si256(reinterpret_cast<const __m256i *>(ws));
+        const __m256i byteMask = _mm256_set1_epi32(0xff);
+        const __m256 minD = _mm256_set1_ps(float32(_minDisparity));
+        const __m256 maxD = _mm256_set1_ps(float32(_maxDisparity));
+
+        const __m256 w = _mm256_mul_ps(_mm256_cvtepi32_ps(wq), _mm256_set1_ps(1.0f / 255.0f));
+        const __m256i rowIdx = _mm256_mullo_epi32(yi, _mm256_set1_epi32(_width));
+        const PMSSubpixelFeature *subBase = (_subpixelImage != nullptr) ?
+                                            _subpixelImage->getData() + uint64(yBase) * _subpixelImage->getRowSize() :
+                                            nullptr;
+        const __m256i subRowOfs = _mm256_mullo_epi32(
+                _mm256_sub_epi32(yi, _mm256_set1_epi32(yBase)),
+                _mm256_set1_epi32(_subpixelImage != nullptr ? _subpixelImage->getRowSize() : 0));
+        const __m256i idx = _mm256_add_epi32(rowIdx, xi);
+        const __m256 xF = _mm256_cvtepi32_ps(xi);
+        const __m256 yF = _mm256_cvtepi32_ps(yi);
+
+        // 左影像q点颜色、梯度
+        const __m256i colQ = gatherColorAVX2(_imgLeft, idx);
+        const __m256 bL = _mm256_cvtepi32_ps(_mm256_and_si256(colQ, byteMask));
+        const __m256 gL = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(colQ, 8), byteMask));
+        const __m256 rL = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(colQ, 16), byteMask));
+        const __m256i gradQ = _mm256_i32gather_epi32(reinterpret_cast<const int *>(_gradLeft), idx, 4);
+        const __m256 gxL = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(gradQ, 16), 16));
+        const __m256 gyL = _mm256_cvtepi32_ps(_mm256_srai_epi32(gradQ, 16));
+
+        for (sint32 k = 0; k < num; k++) {
+            if (!alive[k]) {
+                continue;
+            }
+            const auto &p = planes[k]._p;
+            const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p._x), xF),
+                                                         _mm256_mul_ps(_mm256_set1_ps(p._y), yF)),
+                                           _mm256_set1_ps(p._z));
+            // 视差越界的像素已计入惩罚，此处不再累加
+            const __m256 inDisp = _mm256_and_ps(_mm256_cmp_ps(d, minD, _CMP_GE_OQ),
+                                                _mm256_cmp_ps(d, maxD, _CMP_LE_OQ));
+            const __m256 xr = _mm256_sub_ps(xF, d);
+            const __m256 cost = (_subpixelImage != nullptr) ?
+                                computeSubpixelAVX2(subBase, subRowOfs, xr, bL, gL, rL, gxL, gyL) :
+                                computeAVX2(rowIdx, xr, bL, gL, rL, gxL, gyL);
+            acc[k] = _mm256_add_ps(acc[k], _mm256_and_ps(_mm256_mul_ps(w, cost), inDisp));
+        }
+    }
+
+    /** \brief 权值缓存AVX2实现中收集的保留像素达到该数量后累加 */
+    static constexpr sint32 CACHED_FLUSH_SIZE = 64;
+
+    /** \brief 8通道压缩的重排表：下标为通道掩码，依次为各置位通道的序号，其余补0 */
+    struct CompressTable {
+        uint8 _perm[256][8];
+
+        CompressTable() : _perm() {
+            for (sint32 m = 0; m < 256; m++) {
+                sint32 n = 0;
+                for (sint32 i = 0; i < 8; i++) {
+                    if (m & (1 << i)) {
+                        _perm[m][n++] = uint8(i);
+                    }
+                }
+            }
+        }
+    };
+
+    /**
+     * \brief 使用权值缓存累加窗口内各候选平面的代价（AVX2实现，每次处理8个保留的像素）
+     * 窗口权值每次读取8个，按非零掩码将保留的像素压缩写入缓冲，每8个一组累加，遍历顺序与标量实现一致；
+     * 越界惩罚的处理与aggregateCached一致，每处理64个像素检查一次上界
+     * \return 被剪枝的候选数量
+     */
+    __attribute__((target("avx2")))
+    sint32 aggregateCachedAVX2(const sint32 &x, const sint32 &y,
+                               const sint32 &xBegin, const sint32 &xEnd, const sint32 &yBegin, const sint32 &yEnd,
+                               const DisparityPlane *planes, const sint32 &num, float32 *costs,
+                               const float32 &bound) {
+        static const CompressTable compress;
+
+        bool alive[MAX_AGGREGATION_BATCH];
+        sint32 numAlive = 0;
+        sint32 numPruned = 0;
+        for (sint32 k = 0; k < num; k++) {
+            costs[k] = float32(countOutOfRange(planes[k], xBegin, xEnd, yBegin, yEnd)) * COST_PUNISH;
+            alive[k] = costs[k] <= bound;
+            numAlive += alive[k] ? 1 : 0;
+            numPruned += alive[k] ? 0 : 1;
+        }
+
+        __m256 acc[MAX_AGGREGATION_BATCH];
+        for (sint32 k = 0; k < num; k++) {
+            acc[k] = _mm256_setzero_ps();
+        }
+
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i zeroI = _mm256_setzero_si256();
+
+        // 已收集、尚未累加的保留像素；达到CACHED_FLUSH_SIZE前至多再写入8个通道
+        alignas(32) sint32 bufX[CACHED_FLUSH_SIZE + 16];
+        alignas(32) sint32 bufY[CACHED_FLUSH_SIZE + 16];
+        alignas(32) sint32 bufW[CACHED_FLUSH_SIZE + 16];
+        sint32 numBuf = 0;
+        sint32 numDone = 0;
+
+        // 累加缓冲中的前count个像素（count为8的倍数），每64个像素检查一次上界
+        const auto flush = [&](const sint32 &count) {
+            for (sint32 i = 0; i < count && numAlive > 0; i += 8) {
+                if (numDone > 0 && (numDone & 63) == 0) {
+                    pruneCachedAVX2(costs, acc, num, bound, alive, numAlive, numPruned);
+                }
+                if (numAlive > 0) {
+                    accumulateCachedAVX2(bufX + i, bufY + i, bufW + i, yBegin, planes, alive, num, acc);
+                }
+                numDone += 8;
+            }
+        };
+
+        const sint32 patchSize = _weightCache->getPatchSize();
+        const sint32 patHalf = patchSize / 2;
+        const uint8 *window = _weightCache->getWindow(x, y);
+        for (sint32 yL = yBegin; yL <= yEnd && numAlive > 0; yL++) {
+            const uint8 *weights = window + (yL - y + patHalf) * patchSize + patHalf;
+            const __m256i yi = _mm256_set1_epi32(yL);
+            for (sint32 x0 = xBegin; x0 <= xEnd; x0 += 8) {
+                // 超出本行窗口范围的通道不参与
+                const __m256i xi = _mm256_add_epi32(_mm256_set1_epi32(x0), lane);
+                const __m256i wq = _mm256_cvtepu8_epi32(
+                        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(weights + x0 - x)));
+                const __m256i kept = _mm256_andnot_si256(_mm256_cmpeq_epi32(wq, zeroI),
+                                                         _mm256_cmpgt_epi32(_mm256_set1_epi32(xEnd + 1), xi));
+                const sint32 mask = _mm256_movemask_ps(_mm256_castsi256_ps(kept));
+                if (mask == 0) {
+                    continue;
+                }
+
+                // 保留的像素压缩到低位通道后整体写入缓冲末尾
+                const __m256i perm = _mm256_cvtepu8_epi32(
+                        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(compress._perm[mask])));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(bufX + numBuf), _mm256_permutevar8x32_epi32(xi, perm));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(bufY + numBuf), yi);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(bufW + numBuf), _mm256_permutevar8x32_epi32(wq, perm));
+                numBuf += __builtin_popcount(uint32(mask));
+
+                // 缓冲较满时累加，不足8个的余数移到缓冲开头
+                if (numBuf >= CACHED_FLUSH_SIZE) {
+                    const sint32 count = numBuf / 8 * 8;
+                    flush(count);
+                    for (sint32 i = count; i < numBuf; i++) {
+                        bufX[i - count] = bufX[i];
+                        bufY[i - count] = bufY[i];
+                        bufW[i - count] = bufW[i];
+                    }
+                    numBuf -= count;
+                }
+            }
+        }
+
+        // 末尾不足8个时以首个像素补齐，补齐的权值为0
+        if (numBuf % 8 != 0) {
+            for (sint32 i = numBuf; i % 8 != 0; i++) {
+                bufX[i] = bufX[0];
+                bufY[i] = bufY[0];
+                bufW[i] = 0;
+            }
+        }
+        flush((numBuf + 7) / 8 * 8);
+
+        for (sint32 k = 0; k < num; k++) {
+            costs[k] += horizontalSumAVX2(acc[k]);
+        }
+        return numPruned;
+    }
+#endif
+
     /** \brief 左影像梯度数据 */
     const PGradient *_gradLeft;
     /** \brief 右影像梯度数据 */
     const PGradient *_gradRight;
 
-    /** \brief 参数gamma */
-    float32 _gamma;
     /** \brief 参数alpha */
     float32 _alpha;
     /** \brief 参数tau_col */
     float32 _tauCol;
     /** \brief 参数tau_grad */
     float32 _tauGrad;
+
+    /** \brief 是否使用SIMD聚合核 */
+    bool _isUseSimd;
+
+    /** \brief 右影像的亚像素预插值特征 */
+    const PMSSubpixelImage *_subpixelImage;
+    /** \brief 左影像的分平面特征 */
+    const PMSFeatureImage *_featureImage;
 };
 
 
+/** \brief Census变换窗口宽、高，窗口内除中心外的像素各占1位，编码为一个64位整数 */
+constexpr sint32 CENSUS_WIDTH = 9;
+constexpr sint32 CENSUS_HEIGHT = 7;
+constexpr sint32 CENSUS_BITS = CENSUS_WIDTH * CENSUS_HEIGHT - 1;
+
+/**
+ * \brief 代价计算器：Census变换代价计算器
+ * 左右影像每像素的Census编码为64位比特串，由预处理阶段计算后传入，单像素代价为汉明距离（硬件popcount），
+ * 亚像素位置取相邻两像素汉明距离的线性插值。支持权值与PMS代价相同，由左影像颜色差决定。
+ * 代价按比例缩放到PMS代价的取值范围，越界惩罚与视差越界惩罚的相对大小保持不变
+ */
+class CostComputerCensus final : public CostAggregator<CostComputerCensus> {
+    friend class CostAggregator<CostComputerCensus>;
+
+public:
+    /** \brief Census代价计算器默认构造 */
+    CostComputerCensus() : _costMax(0), _costScale(0), _censusLeft(nullptr), _censusRight(nullptr),
+                           _isUseSimd(false), _isUsePopcnt(false) {};
+
+    /**
+     * \brief Census代价计算器带参构造
+     * \param img_left		左影像数据
+     * \param img_right		右影像数据
+     * \param census_left	左影像Census编码，由computeGradientBand计算
+     * \param census_right	右影像Census编码
+     * \param width			影像宽
+     * \param height		影像高
+     * \param patch_size	局部Patch大小
+     * \param min_disp		最小视差
+     * \param max_disp		最大视差
+     * \param gamma			参数gamma值
+     * \param alpha			参数alpha值
+     * \param t_col			参数tau_col值
+     * \param t_grad		参数tau_grad值
+     */
+    CostComputerCensus(const uint8 *imgLeft, const uint8 *imgRight,
+                       const uint64 *censusLeft, const uint64 *censusRight,
+                       const sint32 &width, const sint32 &height,
+                       const sint32 &patchSize,
+                       const sint32 &minDisparity, const sint32 &maxDisparity,
+                       const float32 &gamma, const float32 &alpha,
+                       const float32 &tauCol, const float32 tauGrad) :
+            CostAggregator(imgLeft, imgRight, width, height, patchSize, minDisparity, maxDisparity, gamma) {
+        _costMax = (1.0f - alpha) * tauCol + alpha * tauGrad;
+        _costScale = _costMax / float32(CENSUS_BITS);
+
+        _censusLeft = censusLeft;
+        _censusRight = censusRight;
+
+        _isUseSimd = false;
+        _isUsePopcnt = false;
+    }
+
+    /**
+     * \brief 由视图输入构建代价计算器，使用影像及Census编码
+     * \param option	算法参数，取Patch尺寸、代价参数及是否使用SIMD
+     * \param input		视图输入
+     */
+    static CostComputerCensus create(const PMSOption &option, const PMSCostInput &input) {
+        CostComputerCensus costCpt(input._imgLeft, input._imgRight, input._censusLeft, input._censusRight,
+                                   input._width, input._height, option._patchSize,
+                                   input._minDisparity, input._maxDisparity,
+                                   option._gamma, option._alpha, option._tauCol, option._tauGrad);
+        costCpt.setUseSimd(option._isUseSimd);
+        costCpt.setWeightCache(input._weightCache);
+        costCpt.setCostVolume(input._costVolume);
+        return costCpt;
+    }
+
+    /**
+     * \brief 设置是否使用SIMD聚合核：CPU支持AVX2时使用AVX2聚合核，否则仅在支持时使用popcount指令
+     * \param isUseSimd	是否使用SIMD
+     * \return 实际是否使用SIMD
+     */
+    bool setUseSimd(const bool &isUseSimd) {
+        _isUseSimd = isUseSimd && CostComputerPMS::isSimdSupported();
+        _isUsePopcnt = isUseSimd && isSimdSupported();
+        return _isUseSimd || _isUsePopcnt;
+    }
+
+    /** \brief 当前CPU是否支持popcount指令 */
+    static bool isSimdSupported() {
+#ifdef PMS_USE_POPCNT
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("popcnt");
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * \brief 计算左影像p点视差为d时的代价值
+     * \param x		p点x坐标
+     * \param y		p点y坐标
+     * \param d		视差值
+     * \return 代价值
+     */
+    float32 compute(const sint32 &x, const sint32 &y, const float32 &d) override {
+        return computeCensus(_censusLeft[y * _width + x], y, float32(x) - d);
+    }
+
+    /**
+     * \brief 已知左影像q点Census编码时，计算其与右影像同名点xr的代价值
+     * \param censusQ	q点Census编码
+     * \param y		q点y坐标
+     * \param xr		右影像同名点x坐标
+     * \return 代价值
+     */
+    PMS_FORCE_INLINE float32 computeCensus(const uint64 &censusQ, const sint32 &y, const float32 &xr) const {
+        if (xr < 0.0f || xr >= float32(_width)) {
+            return _costMax;
+        }
+        const auto x1 = sint32(xr);
+        const sint32 x2 = std::min(x1 + 1, _width - 1);
+        const float32 ofs = xr - float32(x1);
+        const uint64 *row = _censusRight + y * _width;
+        const auto h1 = float32(hamming(censusQ, row[x1]));
+        const auto h2 = float32(hamming(censusQ, row[x2]));
+        return ((1.0f - ofs) * h1 + ofs * h2) * _costScale;
+    }
+
+private:
+    /** \brief 两个Census编码的汉明距离 */
+    static PMS_FORCE_INLINE sint32 hamming(const uint64 &a, const uint64 &b) {
+#if defined(__GNUC__)
+        return __builtin_popcountll(a ^ b);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        return sint32(__popcnt64(a ^ b));
+#else
+        uint64 v = a ^ b;
+        v = v - ((v >> 1) & 0x5555555555555555ull);
+        v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+        v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+        return sint32((v * 0x0101010101010101ull) >> 56);
+#endif
+    }
+
+    /**
+     * \brief 累加窗口中一行像素在各候选平面下的加权代价
+     * \param yL		行号
+     * \param xBegin	起始列号
+     * \param xEnd		结束列号（含）
+     * \param colP		中心像素p的颜色
+     * \param planes	候选平面数组
+     * \param num		候选平面数量
+     * \param costs	各候选平面的累加代价值
+     * \tparam Width	编译期行宽，0表示由xBegin、xEnd决定
+     */
+    template<sint32 Width>
+    PMS_FORCE_INLINE void aggregateRow(const sint32 &yL, const sint32 &xBegin, const sint32 &xEnd, const uint8 *colP,
+                                       const DisparityPlane *planes, const sint32 &num, float32 *costs) {
+        const sint32 count = Width > 0 ? Width : xEnd - xBegin + 1;
+        const uint8 *colRow = _imgLeft + yL * _width * 3;
+        const uint64 *censusRow = _censusLeft + yL * _width;
+        for (sint32 i = 0; i < count; i++) {
+            const sint32 xL = xBegin + i;
+            const uint8 *colQ = colRow + xL * 3;
+            const auto dc = std::abs(colP[0] - colQ[0]) + std::abs(colP[1] - colQ[1]) + std::abs(colP[2] - colQ[2]);
+            const auto w = _weightLut[dc];
+            const uint64 censusQ = censusRow[xL];
+
+            for (sint32 k = 0; k < num; k++) {
+                const float32 d = planes[k].getDisparity(xL, yL);
+                if (d < float32(_minDisparity) || d > float32(_maxDisparity)) {
+                    costs[k] += COST_PUNISH;
+                    continue;
+                }
+                costs[k] += w * computeCensus(censusQ, yL, float32(xL) - d);
+            }
+        }
+    }
+
+#ifdef PMS_USE_POPCNT
+    /** \brief 同aggregateRow，以popcount指令编译，汉明距离为单条指令 */
+    template<sint32 Width>
+    __attribute__((target("popcnt")))
+    void aggregateRowPopcnt(const sint32 &yL, const sint32 &xBegin, const sint32 &xEnd, const uint8 *colP,
+                            const DisparityPlane *planes, const sint32 &num, float32 *costs) {
+        aggregateRow<Width>(yL, xBegin, xEnd, colP, planes, num, costs);
+    }
+#endif
+
+#ifdef PMS_USE_AVX2
+    /** \brief 4个64位通道各自的置位数（按半字节查表） */
+    __attribute__((target("avx2")))
+    static __m256i popcount64AVX2(const __m256i &v) {
+        const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                             0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i lowMask = _mm256_set1_epi8(0x0f);
+        const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, lowMask));
+        const __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask));
+        return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+    }
+
+    /**
+     * \brief 按像素序号收集8个像素的Census编码，前4个及后4个像素分别存于两个向量
+     */
+    __attribute__((target("avx2")))
+    static void gatherCensusAVX2(const uint64 *census, const __m256i &idx, __m256i &lo, __m256i &hi) {
+        const auto *base = reinterpret_cast<const long long *>(census);
+        lo = _mm256_i32gather_epi64(base, _mm256_castsi256_si128(idx), 8);
+        hi = _mm256_i32gather_epi64(base, _mm256_extracti128_si256(idx, 1), 8);
+    }
+
+    /**
+     * \brief 计算8个左影像像素的Census编码与右影像指定像素的汉明距离
+     * \param idx	右影像像素序号
+     * \param censusLo censusHi	左影像像素的Census编码，见gatherCensusAVX2
+     */
+    __attribute__((target("avx2")))
+    __m256 hammingAVX2(const __m256i &idx, const __m256i &censusLo, const __m256i &censusHi) const {
+        __m256i lo, hi;
+        gatherCensusAVX2(_censusRight, idx, lo, hi);
+        const __m256i countLo = popcount64AVX2(_mm256_xor_si256(lo, censusLo));
+        const __m256i countHi = popcount64AVX2(_mm256_xor_si256(hi, censusHi));
+        // 交错合并为 0,4,1,5,2,6,3,7 后恢复像素顺序
+        const __m256i mixed = _mm256_blend_epi32(countLo, _mm256_slli_epi64(countHi, 32), 0xaa);
+        return _mm256_cvtepi32_ps(_mm256_permutevar8x32_epi32(mixed, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7)));
+    }
+
+    /**
+     * \brief 累加窗口中一行像素在各候选平面下的加权代价（AVX2实现，每次处理8个像素）
+     * 与标量实现逐像素运算一致，仅累加顺序不同
+     */
+    template<sint32 Width>
+    __attribute__((target("avx2")))
+    void aggregateRowAVX2(const sint32 &yL, const sint32 &xBegin, const sint32 &xEnd, const uint8 *colP,
+                          const DisparityPlane *planes, const sint32 &num, float32 *costs) {
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i byteMask = _mm256_set1_epi32(0xff);
+        const __m256i rowIdx = _mm256_set1_epi32(yL * _width);
+        const __m256i colPb = _mm256_set1_epi32(colP[0]);
+        const __m256i colPg = _mm256_set1_epi32(colP[1]);
+        const __m256i colPr = _mm256_set1_epi32(colP[2]);
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i maxX = _mm256_set1_epi32(_width - 1);
+
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 minD = _mm256_set1_ps(float32(_minDisparity));
+        const __m256 maxD = _mm256_set1_ps(float32(_maxDisparity));
+        const __m256 widthF = _mm256_set1_ps(float32(_width));
+        const __m256 maxXF = _mm256_set1_ps(float32(_width - 1));
+        const __m256 yF = _mm256_set1_ps(float32(yL));
+        const __m256 punish = _mm256_set1_ps(COST_PUNISH);
+        const __m256 costMax = _mm256_set1_ps(_costMax);
+        const __m256 costScale = _mm256_set1_ps(_costScale);
+
+        __m256 acc[MAX_AGGREGATION_BATCH];
+        for (sint32 k = 0; k < num; k++) {
+            acc[k] = zero;
+        }
+
+        const sint32 count = Width > 0 ? Width : xEnd - xBegin + 1;
+        for (sint32 i = 0; i < count; i += 8) {
+            const sint32 x0 = xBegin + i;
+            // 超出本行窗口范围的通道不参与累加，其坐标钳制到窗口内以保证访存合法
+            __m256i xi = _mm256_add_epi32(_mm256_set1_epi32(x0), lane);
+            const __m256 valid = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(xEnd + 1), xi));
+            xi = _mm256_min_epi32(xi, _mm256_set1_epi32(xEnd));
+            const __m256 xF = _mm256_cvtepi32_ps(xi);
+            const __m256i idxL = _mm256_add_epi32(rowIdx, xi);
+
+            // 左影像q点的支持权值及Census编码，由所有候选平面共享
+            const __m256i colQ = gatherColorAVX2(_imgLeft, idxL);
+            const __m256i dcw = _mm256_add_epi32(_mm256_add_epi32(
+                    _mm256_abs_epi32(_mm256_sub_epi32(colPr, _mm256_and_si256(_mm256_srli_epi32(colQ, 16), byteMask))),
+                    _mm256_abs_epi32(_mm256_sub_epi32(colPg, _mm256_and_si256(_mm256_srli_epi32(colQ, 8), byteMask)))),
+                    _mm256_abs_epi32(_mm256_sub_epi32(colPb, _mm256_and_si256(colQ, byteMask))));
+            const __m256 w = _mm256_and_ps(_mm256_i32gather_ps(_weightLut.data(), dcw, 4), valid);
+            __m256i censusLo, censusHi;
+            gatherCensusAVX2(_censusLeft, idxL, censusLo, censusHi);
+
+            for (sint32 k = 0; k < num; k++) {
+                const auto &p = planes[k]._p;
+                const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p._x), xF),
+                                                             _mm256_mul_ps(_mm256_set1_ps(p._y), yF)),
+                                               _mm256_set1_ps(p._z));
+                const __m256 outDisp = _mm256_or_ps(_mm256_cmp_ps(d, minD, _CMP_LT_OQ),
+                                                    _mm256_cmp_ps(d, maxD, _CMP_GT_OQ));
+
+                // 同名点越界的通道钳制后采样，结果再替换为越界代价
+                const __m256 xr = _mm256_sub_ps(xF, d);
+                const __m256 outImg = _mm256_or_ps(_mm256_cmp_ps(xr, zero, _CMP_LT_OQ),
+                                                   _mm256_cmp_ps(xr, widthF, _CMP_GE_OQ));
+                const __m256 xrc = _mm256_min_ps(_mm256_max_ps(xr, zero), maxXF);
+                const __m256i x1 = _mm256_cvttps_epi32(xrc);
+                const __m256i x2 = _mm256_min_epi32(_mm256_add_epi32(x1, one), maxX);
+                const __m256 ofs = _mm256_sub_ps(xrc, _mm256_cvtepi32_ps(x1));
+                const __m256 h1 = hammingAVX2(_mm256_add_epi32(rowIdx, x1), censusLo, censusHi);
+                const __m256 h2 = hammingAVX2(_mm256_add_epi32(rowIdx, x2), censusLo, censusHi);
+                const __m256 h = _mm256_add_ps(h1, _mm256_mul_ps(ofs, _mm256_sub_ps(h2, h1)));
+                const __m256 cost = _mm256_blendv_ps(_mm256_mul_ps(h, costScale), costMax, outImg);
+
+                const __m256 weighted = _mm256_blendv_ps(_mm256_mul_ps(w, cost), punish, outDisp);
+                acc[k] = _mm256_add_ps(acc[k], _mm256_and_ps(weighted, valid));
+            }
+        }
+
+        for (sint32 k = 0; k < num; k++) {
+            costs[k] += horizontalSumAVX2(acc[k]);
+        }
+    }
+#endif
+
+    /** \brief 读取左影像q点的Census编码 */
+    PMS_FORCE_INLINE uint64 loadPixel(const sint32 &x, const sint32 &y) const {
+        return _censusLeft[y * _width + x];
+    }
+
+    /** \brief 计算左影像q点与右影像同名点xr的代价值 */
+    PMS_FORCE_INLINE float32 computePixel(const uint64 &censusQ, const sint32 &y, const float32 &xr) const {
+        return computeCensus(censusQ, y, xr);
+    }
+
+    /** \brief 累加窗口中一行像素在各候选平面下的加权代价，按CPU支持依次选择AVX2、popcount及标量实现 */
+    template<sint32 Width>
+    PMS_FORCE_INLINE void aggregateRowKernel(const sint32 &yL, const sint32 &xBegin, const sint32 &xEnd,
+                                             const uint8 *colP,
+                                             const DisparityPlane *planes, const sint32 &num, float32 *costs) {
+#ifdef PMS_USE_AVX2
+        if (_isUseSimd) {
+            aggregateRowAVX2<Width>(yL, xBegin, xEnd, colP, planes, num, costs);
+            return;
+        }
+#endif
+#ifdef PMS_USE_POPCNT
+        if (_isUsePopcnt) {
+            aggregateRowPopcnt<Width>(yL, xBegin, xEnd, colP, planes, num, costs);
+            return;
+        }
+#endif
+        aggregateRow<Width>(yL, xBegin, xEnd, colP, planes, num, costs);
+    }
+
+    /** \brief 单像素代价上限（同名点越界时的代价），与PMS代价一致 */
+    float32 _costMax;
+    /** \brief 汉明距离到代价的比例 */
+    float32 _costScale;
+
+    /** \brief 左右影像的Census编码 */
+    const uint64 *_censusLeft;
+    const uint64 *_censusRight;
+
+    /** \brief 是否使用AVX2聚合核 */
+    bool _isUseSimd;
+    /** \brief 是否使用popcount指令 */
+    bool _isUsePopcnt;
+};
+
 #endif //COSTCOMPUTER_HPP
@@ -0,0 +1,124 @@
+//
+// Created by tianhe on 2022/9/14.
+//
+
+#ifndef PMSARENA_H
+#define PMSARENA_H
+
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "PMSType.h"
+
+/**
+ * \brief 内存池：所有工作缓冲区共用一块连续内存，按序分配
+ * 每个缓冲区按缓存行对齐；内存池较大时起始地址按大页对齐，Linux下提示内核使用透明大页。
+ * 重新分配时若容量足够则直接复用，只在容量不足时扩大
+ */
+class PMSArena {
+public:
+    /** \brief 缓冲区对齐字节数（缓存行） */
+    static constexpr uint64 ALIGNMENT = 64;
+    /** \brief 大页字节数 */
+    static constexpr uint64 HUGE_PAGE_SIZE = uint64(2) << 20;
+
+    PMSArena() : _raw(nullptr), _base(nullptr), _capacity(0), _used(0) {}
+
+    ~PMSArena() {
+        release();
+    }
+
+    PMSArena(const PMSArena &) = delete;
+
+    PMSArena &operator=(const PMSArena &) = delete;
+
+    /** \brief 按缓冲区对齐字节数向上取整 */
+    static uint64 alignUp(const uint64 &bytes) {
+        return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    /**
+     * \brief 保证容量不小于指定字节数，并清空已分配的缓冲区
+     * 容量足够时复用原有内存，否则重新分配（原有内容不保留）
+     * \param bytes 所需字节数
+     * \return 是否成功
+     */
+    bool reserve(const uint64 &bytes) {
+        _used = 0;
+        if (bytes <= _capacity) {
+            return true;
+        }
+        release();
+
+        const uint64 align = (bytes >= HUGE_PAGE_SIZE) ? HUGE_PAGE_SIZE : ALIGNMENT;
+        _raw = new(std::nothrow) uint8[bytes + align];
+        if (_raw == nullptr) {
+            return false;
+        }
+        const uint64 addr = uint64(reinterpret_cast<std::uintptr_t>(_raw));
+        _base = _raw + ((align - addr % align) % align);
+        _capacity = bytes;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (align == HUGE_PAGE_SIZE) {
+            madvise(_base, size_t(bytes / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE), MADV_HUGEPAGE);
+        }
+#endif
+        return true;
+    }
+
+    /**
+     * \brief 从内存池中分配缓冲区，并对各元素执行默认构造
+     * \param count 元素个数
+     * \return 缓冲区指针，容量不足时返回nullptr
+     */
+    template<typename T>
+    T *allocate(const uint64 &count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena buffers are never destructed");
+        const uint64 bytes = alignUp(count * sizeof(T));
+        if (_base == nullptr || _used + bytes > _capacity) {
+            return nullptr;
+        }
+        T *ptr = reinterpret_cast<T *>(_base + _used);
+        _used += bytes;
+        for (uint64 i = 0; i < count; i++) {
+            ::new(static_cast<void *>(ptr + i)) T();
+        }
+        return ptr;
+    }
+
+    /** \brief 释放内存 */
+    void release() {
+        delete[] _raw;
+        _raw = nullptr;
+        _base = nullptr;
+        _capacity = 0;
+        _used = 0;
+    }
+
+    /** \brief 容量字节数 */
+    uint64 getCapacity() const {
+        return _capacity;
+    }
+
+    /** \brief 已分配的字节数 */
+    uint64 getUsed() const {
+        return _used;
+    }
+
+private:
+    /** \brief 原始内存及对齐后的起始地址 */
+    uint8 *_raw;
+    uint8 *_base;
+
+    /** \brief 容量及已分配的字节数 */
+    uint64 _capacity;
+    uint64 _used;
+};
+
+#endif //PMSARENA_H
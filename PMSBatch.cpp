@@ -0,0 +1,113 @@
+//
+// Created by tianhe on 2022/9/16.
+//
+
+#include "PMSBatch.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+#include "PMSParallel.h"
+
+PMSBatchMatcher::PMSBatchMatcher(const PMSOption &option, const sint32 &numEngines,
+                                 const sint32 &width, const sint32 &height) {
+    const sint32 num = resolveThreadCount(numEngines);
+    _option = option;
+    // 各实例并行处理不同像对，未指定线程数时平分硬件线程，避免线程超额
+    if (_option._numThreads <= 0) {
+        _option._numThreads = std::max(1, resolveThreadCount(0) / num);
+    }
+
+    _engines.resize(num);
+    for (auto &engine: _engines) {
+        engine.reset(new PatchMatchStereo());
+        if (width > 0 && height > 0) {
+            engine->initialize(width, height, _option);
+        }
+    }
+}
+
+std::vector<PMSBatchResult> PMSBatchMatcher::match(const std::vector<PMSBatchItem> &items, const Callback &onMatched) {
+    return match(sint32(items.size()), [&](const sint32 &index, const sint32 &, PMSBatchItem &item) {
+        item = items[index];
+        return true;
+    }, onMatched);
+}
+
+std::vector<PMSBatchResult> PMSBatchMatcher::match(const sint32 &numItems, const Producer &produce,
+                                                   const Callback &onMatched) {
+    std::vector<PMSBatchResult> results(std::max(numItems, 0));
+
+    // 所有任务共用一次调度，工作线程完成一个像对后立即取下一个，不等待其它线程
+    parallelFor(0, numItems, sint32(_engines.size()), [&](const sint32 &i, const sint32 &tid) {
+        auto &result = results[i];
+        auto &engine = *_engines[tid];
+        PMSBatchItem item;
+        if (!produce(i, tid, item) ||
+            item._imgLeft == nullptr || item._imgRight == nullptr || item._width <= 0 || item._height <= 0) {
+            return;
+        }
+
+        // 按像对的尺寸及视差范围重设实例，内存池容量足够时不重新分配
+        PMSOption option = _option;
+        option._minDisparity = item._minDisparity;
+        option._maxDisparity = item._maxDisparity;
+        if (!engine.reset(uint32(item._width), uint32(item._height), option)) {
+            return;
+        }
+
+        // 有回调时由回调直接读取实例的缓冲区，不再复制视差图
+        if (!onMatched) {
+            const size_t size = size_t(item._width) * size_t(item._height);
+            result._dispLeft.resize(size);
+            if (!option._isLeftOnly) {
+                result._dispRight.resize(size);
+            }
+        }
+        result._isSuccess = engine.match(item._imgLeft, item._imgRight,
+                                         result._dispLeft.empty() ? nullptr : result._dispLeft.data(),
+                                         result._dispRight.empty() ? nullptr : result._dispRight.data());
+        result._statistics = engine.getStatistics();
+        if (result._isSuccess && onMatched) {
+            onMatched(i, engine);
+        }
+    });
+
+    return results;
+}
+
+sint32 PMSBatchMatcher::getNumEngines() const {
+    return sint32(_engines.size());
+}
+
+bool PMSBatchMatcher::loadDisparityRange(const std::string &path, sint32 &minDisparity, sint32 &maxDisparity) {
+    std::ifstream fin(path);
+    if (!fin.is_open()) {
+        return false;
+    }
+
+    bool hasMin = false, hasMax = false;
+    std::string line;
+    while (std::getline(fin, line)) {
+        const auto pos = line.find('=');
+        if (pos == std::string::npos) {
+            continue;
+        }
+        std::string key = line.substr(0, pos);
+        key.erase(std::remove_if(key.begin(), key.end(), ::isspace), key.end());
+        const std::string value = line.substr(pos + 1);
+        try {
+            if (key == "dmin") {
+                minDisparity = std::stoi(value);
+                hasMin = true;
+            } else if (key == "dmax") {
+                maxDisparity = std::stoi(value);
+                hasMax = true;
+            }
+        } catch (...) {
+            return false;
+        }
+    }
+    return hasMin && hasMax && minDisparity < maxDisparity;
+}
@@ -0,0 +1,115 @@
+//
+// Created by tianhe on 2022/9/16.
+//
+
+#ifndef PMSBATCH_H
+#define PMSBATCH_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PMSType.h"
+#include "PatchMatchStereo.h"
+
+/**
+ * \brief 批量匹配任务：一个核线像对及其视差范围
+ */
+struct PMSBatchItem {
+    const uint8 *_imgLeft;          // 左影像数据指针，3通道
+    const uint8 *_imgRight;         // 右影像数据指针，3通道
+    sint32 _width;                  // 影像宽
+    sint32 _height;                 // 影像高
+    sint32 _minDisparity;           // 最小视差
+    sint32 _maxDisparity;           // 最大视差
+
+    PMSBatchItem() : _imgLeft(nullptr), _imgRight(nullptr), _width(0), _height(0),
+                     _minDisparity(0), _maxDisparity(64) {}
+};
+
+/**
+ * \brief 批量匹配结果
+ */
+struct PMSBatchResult {
+    bool _isSuccess;                        // 是否匹配成功
+    std::vector<float32> _dispLeft;         // 左影像视差图，使用回调时为空
+    std::vector<float32> _dispRight;        // 右影像视差图，只计算左视图或使用回调时为空
+    PMSStatistics _statistics;              // 传播统计量
+
+    PMSBatchResult() : _isSuccess(false) {}
+};
+
+/**
+ * \brief 批量匹配器
+ * 持有固定数量的匹配实例，各像对按提交顺序动态分配给工作线程，每个线程独占一个实例；
+ * 实例的内存池在各像对间复用，结果按提交顺序返回
+ */
+class PMSBatchMatcher {
+public:
+    /**
+     * \brief 单个像对匹配完成后的回调，在工作线程中调用
+     * 参数为任务序号及完成匹配的实例，可直接读取实例的视差图、平面场及代价缓冲区（如写出文件），
+     * 回调返回后该实例即被用于下一个像对
+     */
+    typedef std::function<void(const sint32 &index, const PatchMatchStereo &engine)> Callback;
+
+    /**
+     * \brief 按需产生匹配任务，在工作线程中调用
+     * 参数为任务序号、工作线程序号及待填写的任务；各工作线程取得下一个序号后才调用，可在此读取影像，
+     * 使影像读取、匹配及回调中的写出在不同线程间重叠。任务的影像数据须保持有效直至该线程下一次调用。
+     * 返回false表示任务无效（如读取失败），该任务结果为失败
+     */
+    typedef std::function<bool(const sint32 &index, const sint32 &tid, PMSBatchItem &item)> Producer;
+
+    /**
+     * \brief 构造
+     * \param option		匹配参数，各像对的视差范围由任务指定
+     * \param numEngines	匹配实例（工作线程）数，<=0 时取硬件并发线程数
+     * \param width			预分配内存的影像宽，<=0 时在首次匹配时分配
+     * \param height		预分配内存的影像高，<=0 时在首次匹配时分配
+     */
+    explicit PMSBatchMatcher(const PMSOption &option, const sint32 &numEngines = 0,
+                             const sint32 &width = 0, const sint32 &height = 0);
+
+    ~PMSBatchMatcher() = default;
+
+    /**
+     * \brief 批量匹配
+     * \param items 匹配任务
+     * \param onMatched 可选，各像对匹配成功后的回调；指定时结果中不复制视差图，由回调读取实例的缓冲区
+     * \return 匹配结果，与任务一一对应
+     */
+    std::vector<PMSBatchResult> match(const std::vector<PMSBatchItem> &items, const Callback &onMatched = nullptr);
+
+    /**
+     * \brief 流式批量匹配，各工作线程通过produce取得任务，同时驻留内存的任务数不超过实例数
+     * \param numItems 任务数
+     * \param produce 产生任务，在工作线程中调用
+     * \param onMatched 可选，各像对匹配成功后的回调
+     * \return 匹配结果，与任务序号一一对应
+     */
+    std::vector<PMSBatchResult> match(const sint32 &numItems, const Producer &produce,
+                                      const Callback &onMatched = nullptr);
+
+    /** \brief 匹配实例数 */
+    sint32 getNumEngines() const;
+
+    /**
+     * \brief 读取视差范围文件（如数据集中的d_range.txt，格式为 dmin=... dmax=...）
+     * \param path 文件路径
+     * \param minDisparity 输出，最小视差
+     * \param maxDisparity 输出，最大视差
+     * \return 是否读取成功
+     */
+    static bool loadDisparityRange(const std::string &path, sint32 &minDisparity, sint32 &maxDisparity);
+
+private:
+    /** \brief 匹配实例的参数 */
+    PMSOption _option;
+
+    /** \brief 匹配实例，按工作线程序号使用 */
+    std::vector<std::unique_ptr<PatchMatchStereo>> _engines;
+};
+
+#endif //PMSBATCH_H
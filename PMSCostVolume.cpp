@@ -0,0 +1,224 @@
+//
+// Created by tianhe on 2022/9/22.
+//
+
+#include "PMSCostVolume.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "CostComputer.hpp"
+#include "PMSParallel.h"
+#include "PMSWeightCache.h"
+
+/** \brief 量化代价的最大值 */
+static const float32 QUANTIZED_COST_MAX = 65535.0f;
+
+/**
+ * \brief 累加窗口内各像素的加权代价 acc[k] = sum(w[i] * cost[offsets[i] + k])
+ * \param cost		量化代价体
+ * \param offsets	窗口内各像素代价的起始位置
+ * \param weights	窗口内各像素的支持权值
+ * \param num		窗口内像素数
+ * \param acc		输出，各视差的累加值
+ * \param count		视差个数（已补齐到8的倍数）
+ */
+static void aggregate(const uint16 *cost, const uint64 *offsets, const float32 *weights, const sint32 &num,
+                      float32 *acc, const sint32 &count) {
+    std::fill(acc, acc + count, 0.0f);
+    for (sint32 i = 0; i < num; i++) {
+        const uint16 *c = cost + offsets[i];
+        const float32 w = weights[i];
+        for (sint32 k = 0; k < count; k++) {
+            acc[k] += w * float32(c[k]);
+        }
+    }
+}
+
+#ifdef PMS_USE_AVX2
+/** \brief 加载8个量化代价并转换为浮点 */
+__attribute__((target("avx2")))
+static inline __m256 loadCostAVX2(const uint16 *cost) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cost))));
+}
+
+/**
+ * \brief 累加窗口内各像素的加权代价（AVX2实现，与标量实现逐元素运算一致）
+ * 每次处理32个视差，累加值在整个窗口的遍历中保持在寄存器内
+ */
+__attribute__((target("avx2")))
+static void aggregateAVX2(const uint16 *cost, const uint64 *offsets, const float32 *weights, const sint32 &num,
+                          float32 *acc, const sint32 &count) {
+    sint32 k = 0;
+    for (; k + 32 <= count; k += 32) {
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+        for (sint32 i = 0; i < num; i++) {
+            const uint16 *c = cost + offsets[i] + k;
+            const __m256 w = _mm256_set1_ps(weights[i]);
+            a0 = _mm256_add_ps(a0, _mm256_mul_ps(w, loadCostAVX2(c)));
+            a1 = _mm256_add_ps(a1, _mm256_mul_ps(w, loadCostAVX2(c + 8)));
+            a2 = _mm256_add_ps(a2, _mm256_mul_ps(w, loadCostAVX2(c + 16)));
+            a3 = _mm256_add_ps(a3, _mm256_mul_ps(w, loadCostAVX2(c + 24)));
+        }
+        _mm256_storeu_ps(acc + k, a0);
+        _mm256_storeu_ps(acc + k + 8, a1);
+        _mm256_storeu_ps(acc + k + 16, a2);
+        _mm256_storeu_ps(acc + k + 24, a3);
+    }
+    for (; k < count; k += 8) {
+        __m256 a = _mm256_setzero_ps();
+        for (sint32 i = 0; i < num; i++) {
+            a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_set1_ps(weights[i]), loadCostAVX2(cost + offsets[i] + k)));
+        }
+        _mm256_storeu_ps(acc + k, a);
+    }
+}
+#endif
+
+/** \brief 量化匹配代价的视差维补齐到8的倍数，按8个视差一组累加 */
+static sint32 alignDisparities(const sint32 &numDisparities) {
+    return (numDisparities + 7) / 8 * 8;
+}
+
+PMSCostVolume::PMSCostVolume() : _width(0), _height(0), _capacity(0), _minDisparity(0), _numDisparities(0),
+                                 _costUnit(0.0f), _matchCosts(nullptr), _costs(nullptr) {
+
+}
+
+uint64 PMSCostVolume::getMemoryBytes(const sint32 &width, const sint32 &height, const sint32 &numDisparities) {
+    if (width <= 0 || height <= 0 || numDisparities <= 0) {
+        return 0;
+    }
+    const uint64 size = uint64(width) * uint64(height);
+    return PMSArena::alignUp(size * uint64(alignDisparities(numDisparities)) * sizeof(uint16)) +
+           PMSArena::alignUp(size * uint64(numDisparities) * sizeof(uint16));
+}
+
+bool PMSCostVolume::allocate(PMSArena &arena, const sint32 &width, const sint32 &height,
+                             const sint32 &numDisparities) {
+    release();
+    if (width <= 0 || height <= 0 || numDisparities <= 0) {
+        return false;
+    }
+    _width = width;
+    _height = height;
+    _capacity = numDisparities;
+    const uint64 size = uint64(width) * uint64(height);
+    _matchCosts = arena.allocate<uint16>(size * uint64(alignDisparities(numDisparities)));
+    _costs = arena.allocate<uint16>(size * uint64(numDisparities));
+    if (_matchCosts == nullptr || _costs == nullptr) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+void PMSCostVolume::release() {
+    clear();
+    _width = _height = 0;
+    _capacity = 0;
+    _matchCosts = nullptr;
+    _costs = nullptr;
+}
+
+bool PMSCostVolume::build(CostComputer &costCpt, const uint8 *img, const sint32 &width, const sint32 &height,
+                          const sint32 &patchSize, const float32 &gamma,
+                          const sint32 &minDisparity, const sint32 &maxDisparity, const float32 &costMax,
+                          const PMSWeightCache *weightCache, const sint32 &numThreads, const bool &isUseSimd) {
+    clear();
+    if (_costs == nullptr || img == nullptr || width != _width || height != _height || patchSize <= 0 ||
+        maxDisparity < minDisparity || maxDisparity - minDisparity + 1 > _capacity || costMax <= 0.0f) {
+        return false;
+    }
+
+    // 量化匹配代价体
+    const sint32 numDisp = maxDisparity - minDisparity + 1;
+    const sint32 stride = alignDisparities(numDisp);
+    const float32 scale = QUANTIZED_COST_MAX / costMax;
+    uint16 *quantized = _matchCosts;
+    parallelFor(0, height, numThreads, [&](const sint32 &y, const sint32 &) {
+        for (sint32 x = 0; x < width; x++) {
+            uint16 *cost = quantized + (uint64(y) * uint64(width) + uint64(x)) * uint64(stride);
+            for (sint32 k = 0; k < numDisp; k++) {
+                const float32 c = costCpt.compute(x, y, float32(minDisparity + k));
+                cost[k] = uint16(std::lround(std::min(std::max(c, 0.0f), costMax) * scale));
+            }
+            std::fill(cost + numDisp, cost + stride, uint16(0));
+        }
+    });
+
+    // 支持权值查找表，与代价计算器一致
+    float32 weightLut[3 * 255 + 1];
+    for (sint32 dc = 0; dc <= 3 * 255; dc++) {
+        weightLut[dc] = std::exp(float32(-dc) / gamma);
+    }
+
+#ifdef PMS_USE_AVX2
+    const bool isSimd = isUseSimd && CostComputerPMS::isSimdSupported();
+    const auto aggregateFunc = isSimd ? aggregateAVX2 : aggregate;
+#else
+    const auto aggregateFunc = aggregate;
+#endif
+
+    // 逐像素聚合全部视差：窗口内每个像素的权值只计算一次，再沿视差方向累加。
+    // 支持权值随中心像素变化，相邻窗口的加权和之间没有递推关系，无法按滑动窗口增量更新。
+    // 累加值以量化匹配代价为单位，聚合代价的量化单位为其窗口像素数倍，按比例折算后存储
+    const sint32 patHalf = patchSize / 2;
+    const float32 windowArea = float32(patchSize) * float32(patchSize);
+    const float32 toAggregated = 1.0f / windowArea;
+    parallelFor(0, height, numThreads, [&](const sint32 &y, const sint32 &) {
+        std::vector<float32> acc(stride);
+        std::vector<uint64> offsets(uint64(patchSize) * patchSize);
+        std::vector<float32> weights(uint64(patchSize) * patchSize);
+        for (sint32 x = 0; x < width; x++) {
+            // 收集窗口内各像素的代价位置及权值，使用权值缓存时跳过舍弃的像素
+            const uint8 *window = (weightCache != nullptr && weightCache->contains(x, y)) ?
+                                  weightCache->getWindow(x, y) : nullptr;
+            const sint32 windowStride = (window != nullptr) ? weightCache->getPatchSize() : 0;
+            const sint32 windowHalf = windowStride / 2;
+            const uint8 *colP = img + (uint64(y) * width + x) * 3;
+            const sint32 yBegin = std::max(y - patHalf, 0);
+            const sint32 yEnd = std::min(y + patHalf, height - 1);
+            const sint32 xBegin = std::max(x - patHalf, 0);
+            const sint32 xEnd = std::min(x + patHalf, width - 1);
+            sint32 num = 0;
+            for (sint32 yq = yBegin; yq <= yEnd; yq++) {
+                for (sint32 xq = xBegin; xq <= xEnd; xq++) {
+                    const uint64 q = uint64(yq) * width + xq;
+                    if (window != nullptr) {
+                        const uint8 w = window[(yq - y + windowHalf) * windowStride + (xq - x + windowHalf)];
+                        if (w == 0) {
+                            continue;
+                        }
+                        weights[num] = PMSWeightCache::dequantize(w);
+                    } else {
+                        const uint8 *colQ = img + q * 3;
+                        const sint32 dc = std::abs(colP[0] - colQ[0]) + std::abs(colP[1] - colQ[1]) +
+                                          std::abs(colP[2] - colQ[2]);
+                        weights[num] = weightLut[dc];
+                    }
+                    offsets[num] = q * stride;
+                    num++;
+                }
+            }
+            aggregateFunc(quantized, offsets.data(), weights.data(), num, acc.data(), stride);
+
+            uint16 *cost = _costs + (uint64(y) * uint64(width) + uint64(x)) * uint64(numDisp);
+            for (sint32 k = 0; k < numDisp; k++) {
+                cost[k] = uint16(std::min(std::lround(acc[k] * toAggregated), long(QUANTIZED_COST_MAX)));
+            }
+        }
+    });
+
+    _minDisparity = minDisparity;
+    _numDisparities = numDisp;
+    _costUnit = costMax * windowArea / QUANTIZED_COST_MAX;
+    return true;
+}
+
+void PMSCostVolume::clear() {
+    _minDisparity = _numDisparities = 0;
+    _costUnit = 0.0f;
+}
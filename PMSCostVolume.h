@@ -0,0 +1,108 @@
+//
+// Created by tianhe on 2022/9/22.
+//
+
+#ifndef PMSCOSTVOLUME_H
+#define PMSCOSTVOLUME_H
+
+#include "PMSType.h"
+#include "PMSArena.h"
+
+class CostComputer;
+class PMSWeightCache;
+
+/**
+ * \brief 整数视差聚合代价体
+ * 视差平面强制为Frontal-Parallel且为整像素视差时，候选平面只有视差范围内的有限个取值。
+ * 构建时先以16位量化存储每个像素在各整数视差下的匹配代价，再对每个像素一次性聚合全部视差：
+ * 窗口内每个像素的支持权值只计算一次，各视差的代价在内存中连续存放，可按视差方向向量化累加。
+ * 聚合代价同样以16位量化存储，满量程为窗口像素数乘以单像素代价上限（支持权值不超过1）。
+ * 量化匹配代价及聚合代价均由内存池分配，各次匹配复用，之后传播中的代价计算均为查表
+ */
+class PMSCostVolume {
+public:
+    PMSCostVolume();
+
+    ~PMSCostVolume() = default;
+
+    /** \brief 代价体占用的内存池字节数 */
+    static uint64 getMemoryBytes(const sint32 &width, const sint32 &height, const sint32 &numDisparities);
+
+    /**
+     * \brief 从内存池分配代价数据
+     * \param arena			内存池
+     * \param width			影像宽
+     * \param height		影像高
+     * \param numDisparities	视差个数
+     * \return 是否分配成功
+     */
+    bool allocate(PMSArena &arena, const sint32 &width, const sint32 &height, const sint32 &numDisparities);
+
+    /** \brief 解除与内存池的关联 */
+    void release();
+
+    /**
+     * \brief 构建代价体
+     * \param costCpt		代价计算器，提供逐像素的匹配代价
+     * \param img			影像数据，3通道，用于计算支持权值
+     * \param width			影像宽，须与分配时一致
+     * \param height		影像高，须与分配时一致
+     * \param patchSize		局部Patch大小
+     * \param gamma			参数gamma值
+     * \param minDisparity	最小视差
+     * \param maxDisparity	最大视差，视差个数不超过分配时的容量
+     * \param costMax		单像素代价上限，用于量化
+     * \param weightCache	支持权值缓存，非空时使用其中的量化权值，与逐候选聚合的缓存路径一致
+     * \param numThreads	构建线程数
+     * \param isUseSimd		是否使用SIMD累加
+     * \return 是否构建成功
+     */
+    bool build(CostComputer &costCpt, const uint8 *img, const sint32 &width, const sint32 &height,
+               const sint32 &patchSize, const float32 &gamma,
+               const sint32 &minDisparity, const sint32 &maxDisparity, const float32 &costMax,
+               const PMSWeightCache *weightCache, const sint32 &numThreads, const bool &isUseSimd);
+
+    /** \brief 清空代价体，内存仍保留在内存池中 */
+    void clear();
+
+    /**
+     * \brief 查询像素(x,y)取平面p时的聚合代价
+     * 只有Frontal-Parallel且视差为范围内整数的平面可以查表
+     * \return 是否查到
+     */
+    bool lookup(const DisparityPlane &p, const sint32 &x, const sint32 &y, float32 &cost) const {
+        const float32 d = p._p._z;
+        if (p._p._x != 0.0f || p._p._y != 0.0f || d < float32(_minDisparity) ||
+            d > float32(_minDisparity + _numDisparities - 1)) {
+            return false;
+        }
+        const auto di = sint32(d);
+        if (float32(di) != d) {
+            return false;
+        }
+        cost = float32(_costs[(uint64(y) * uint64(_width) + uint64(x)) * uint64(_numDisparities) +
+                              uint64(di - _minDisparity)]) * _costUnit;
+        return true;
+    }
+
+private:
+    /** \brief 影像宽高 */
+    sint32 _width;
+    sint32 _height;
+    /** \brief 可容纳的视差个数 */
+    sint32 _capacity;
+
+    /** \brief 最小视差及视差个数，未构建时视差个数为0 */
+    sint32 _minDisparity;
+    sint32 _numDisparities;
+
+    /** \brief 聚合代价的量化单位 */
+    float32 _costUnit;
+
+    /** \brief 量化匹配代价，按 行、列、视差 顺序存储，视差维补齐到8的倍数，只在构建时使用 */
+    uint16 *_matchCosts;
+    /** \brief 量化聚合代价，按 行、列、视差 顺序存储 */
+    uint16 *_costs;
+};
+
+#endif //PMSCOSTVOLUME_H
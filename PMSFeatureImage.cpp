@@ -0,0 +1,88 @@
+//
+// Created by tianhe on 2022/9/24.
+//
+
+#include "PMSFeatureImage.h"
+
+#include <algorithm>
+
+#include "PMSParallel.h"
+
+/** \brief 行宽对齐的元素数（一个缓存行） */
+static const sint32 STRIDE_ALIGNMENT = sint32(PMSArena::ALIGNMENT / sizeof(sint16));
+
+PMSFeatureImage::PMSFeatureImage() : _width(0), _height(0), _padding(0), _stride(0), _planeSize(0),
+                                     _data(nullptr) {
+
+}
+
+sint32 PMSFeatureImage::getPadding(const sint32 &patchSize) {
+    const sint32 padding = std::max(patchSize / 2, 8);
+    return (padding + 7) / 8 * 8;
+}
+
+uint64 PMSFeatureImage::getMemoryBytes(const sint32 &width, const sint32 &height, const sint32 &patchSize) {
+    if (width <= 0 || height <= 0) {
+        return 0;
+    }
+    const sint32 padding = getPadding(patchSize);
+    const uint64 stride = uint64(width + 2 * padding + STRIDE_ALIGNMENT - 1) / STRIDE_ALIGNMENT * STRIDE_ALIGNMENT;
+    const uint64 planeSize = stride * uint64(height + 2 * padding);
+    return PMSArena::alignUp(NUM_CHANNELS * planeSize * sizeof(sint16));
+}
+
+bool PMSFeatureImage::allocate(PMSArena &arena, const sint32 &width, const sint32 &height, const sint32 &patchSize) {
+    release();
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    _width = width;
+    _height = height;
+    _padding = getPadding(patchSize);
+    _stride = (width + 2 * _padding + STRIDE_ALIGNMENT - 1) / STRIDE_ALIGNMENT * STRIDE_ALIGNMENT;
+    _planeSize = uint64(_stride) * uint64(height + 2 * _padding);
+    _data = arena.allocate<sint16>(NUM_CHANNELS * _planeSize);
+    if (_data == nullptr) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+void PMSFeatureImage::release() {
+    _width = _height = 0;
+    _padding = _stride = 0;
+    _planeSize = 0;
+    _data = nullptr;
+}
+
+bool PMSFeatureImage::build(const uint8 *img, const PGradient *grad, const sint32 &numThreads) {
+    if (_data == nullptr || img == nullptr || grad == nullptr) {
+        return false;
+    }
+
+    const sint32 width = _width;
+    const sint32 height = _height;
+    const sint32 padding = _padding;
+    // 扩展后的每一行（含上下边界）独立填充，边界处复制最近的影像像素
+    parallelFor(-padding, height + padding, numThreads, [&](const sint32 &y, const sint32 &) {
+        const sint32 ys = std::min(std::max(y, 0), height - 1);
+        const uint8 *row = img + size_t(ys) * width * 3;
+        const PGradient *gradRow = grad + size_t(ys) * width;
+        auto *b = getMutableRow(CHANNEL_B, y);
+        auto *g = getMutableRow(CHANNEL_G, y);
+        auto *r = getMutableRow(CHANNEL_R, y);
+        auto *gx = getMutableRow(CHANNEL_GX, y);
+        auto *gy = getMutableRow(CHANNEL_GY, y);
+        for (sint32 x = -padding; x < _stride - padding; x++) {
+            const sint32 xs = std::min(std::max(x, 0), width - 1);
+            b[x] = row[xs * 3];
+            g[x] = row[xs * 3 + 1];
+            r[x] = row[xs * 3 + 2];
+            gx[x] = gradRow[xs]._x;
+            gy[x] = gradRow[xs]._y;
+        }
+    });
+
+    return true;
+}
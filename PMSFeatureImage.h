@@ -0,0 +1,104 @@
+//
+// Created by tianhe on 2022/9/24.
+//
+
+#ifndef PMSFEATUREIMAGE_H
+#define PMSFEATUREIMAGE_H
+
+#include "PMSType.h"
+#include "PMSArena.h"
+
+/**
+ * \brief 颜色及梯度的分平面（SoA）特征影像
+ * 原始数据中颜色为BGR交错的3通道影像，梯度为单独的数组，窗口内每个像素的颜色和梯度分属两处不相关的缓存行，
+ * 且通道交错不利于向量化。特征影像将B、G、R、梯度x、梯度y分别存为16位整数平面，同一行内连续的像素
+ * 在每个平面内连续，8个像素的同一通道可一次连续读取。
+ * 每个平面四周按边缘复制扩展不小于Patch半径的边界，行首按16字节对齐，行宽按缓存行对齐，
+ * 窗口及尾部不足8个像素的读取均无需边界判断。内存由内存池分配
+ */
+class PMSFeatureImage {
+public:
+    /** \brief 特征通道 */
+    enum Channel {
+        CHANNEL_B = 0,
+        CHANNEL_G,
+        CHANNEL_R,
+        CHANNEL_GX,
+        CHANNEL_GY,
+        NUM_CHANNELS
+    };
+
+    PMSFeatureImage();
+
+    ~PMSFeatureImage() = default;
+
+    /** \brief 边界扩展像素数：不小于Patch半径及8，且为8的倍数 */
+    static sint32 getPadding(const sint32 &patchSize);
+
+    /** \brief 特征影像占用的内存池字节数 */
+    static uint64 getMemoryBytes(const sint32 &width, const sint32 &height, const sint32 &patchSize);
+
+    /**
+     * \brief 从内存池分配特征数据
+     * \param arena		内存池
+     * \param width		影像宽
+     * \param height	影像高
+     * \param patchSize	局部Patch大小，决定边界扩展像素数
+     * \return 是否分配成功
+     */
+    bool allocate(PMSArena &arena, const sint32 &width, const sint32 &height, const sint32 &patchSize);
+
+    /** \brief 解除与内存池的关联 */
+    void release();
+
+    /**
+     * \brief 由影像及梯度构建特征
+     * \param img			影像数据，3通道
+     * \param grad			梯度数据
+     * \param numThreads	构建线程数
+     * \return 是否构建成功
+     */
+    bool build(const uint8 *img, const PGradient *grad, const sint32 &numThreads);
+
+    /** \brief 是否已分配 */
+    bool isValid() const {
+        return _data != nullptr;
+    }
+
+    /** \brief 边界扩展像素数 */
+    sint32 getPadding() const {
+        return _padding;
+    }
+
+    /**
+     * \brief 通道channel第y行x=0处的指针
+     * 行号在[-padding, height+padding)内有效，行内x在[-padding, width+padding)内有效
+     */
+    const sint16 *getRow(const sint32 &channel, const sint32 &y) const {
+        return _data + uint64(channel) * _planeSize + uint64(sint64(y + _padding) * _stride + _padding);
+    }
+
+private:
+    /** \brief 通道channel第y行x=0处的可写指针 */
+    sint16 *getMutableRow(const sint32 &channel, const sint32 &y) {
+        return _data + uint64(channel) * _planeSize + uint64(sint64(y + _padding) * _stride + _padding);
+    }
+
+    /** \brief 影像宽高 */
+    sint32 _width;
+    sint32 _height;
+
+    /** \brief 边界扩展像素数 */
+    sint32 _padding;
+
+    /** \brief 行宽（元素数） */
+    sint32 _stride;
+
+    /** \brief 单个平面的元素数 */
+    uint64 _planeSize;
+
+    /** \brief 特征数据，依次存放各通道平面 */
+    sint16 *_data;
+};
+
+#endif //PMSFEATUREIMAGE_H
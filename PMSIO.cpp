@@ -0,0 +1,208 @@
+//
+// Created by tianhe on 2022/9/20.
+//
+
+#include "PMSIO.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(PMSRawHeader) == 64, "raw header must be one cache line");
+static_assert(sizeof(DisparityPlane) == 3 * sizeof(float32), "planes are written as 3-channel float");
+
+PMSRawHeader::PMSRawHeader() : _magic{'P', 'M', 'S', 'R'}, _version(PMS_RAW_VERSION), _width(0), _height(0),
+                               _channels(0), _dataType(PMS_RAW_FLOAT32), _dataOffset(sizeof(PMSRawHeader)),
+                               _reserved{} {}
+
+/** \brief 当前平台是否为小端字节序 */
+static bool isLittleEndian() {
+    const uint32 value = 1;
+    uint8 byte;
+    memcpy(&byte, &value, 1);
+    return byte == 1;
+}
+
+/** \brief 原始数据类型的字节数，未知类型返回0 */
+static uint64 rawTypeSize(const uint32 &dataType) {
+    switch (dataType) {
+        case PMS_RAW_FLOAT32:
+            return sizeof(float32);
+        case PMS_RAW_UINT8:
+            return sizeof(uint8);
+        default:
+            return 0;
+    }
+}
+
+bool writePfm(const std::string &path, const float32 *data, const sint32 &width, const sint32 &height,
+              const sint32 &channels) {
+    if (data == nullptr || width <= 0 || height <= 0 || (channels != 1 && channels != 3)) {
+        return false;
+    }
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (fp == nullptr) {
+        return false;
+    }
+
+    // 比例因子为负表示小端
+    bool isSuccess = fprintf(fp, "%s\n%d %d\n%s\n", channels == 1 ? "Pf" : "PF", width, height,
+                             isLittleEndian() ? "-1.0" : "1.0") > 0;
+
+    // PFM自下而上存储，逐行写出，无需中间缓冲
+    const size_t rowSize = size_t(width) * size_t(channels);
+    for (sint32 i = height - 1; i >= 0 && isSuccess; i--) {
+        isSuccess = fwrite(data + size_t(i) * rowSize, sizeof(float32), rowSize, fp) == rowSize;
+    }
+    return (fclose(fp) == 0) && isSuccess;
+}
+
+bool writeRaw(const std::string &path, const void *data, const sint32 &width, const sint32 &height,
+              const sint32 &channels, const PMSRawType &dataType) {
+    const uint64 typeSize = rawTypeSize(dataType);
+    if (data == nullptr || width <= 0 || height <= 0 || channels <= 0 || typeSize == 0 || !isLittleEndian()) {
+        return false;
+    }
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (fp == nullptr) {
+        return false;
+    }
+
+    PMSRawHeader header;
+    header._width = uint32(width);
+    header._height = uint32(height);
+    header._channels = uint32(channels);
+    header._dataType = dataType;
+
+    const size_t bytes = size_t(width) * size_t(height) * size_t(channels) * size_t(typeSize);
+    bool isSuccess = fwrite(&header, sizeof(header), 1, fp) == 1;
+    isSuccess = isSuccess && fwrite(data, 1, bytes, fp) == bytes;
+    return (fclose(fp) == 0) && isSuccess;
+}
+
+bool readRawHeader(const std::string &path, PMSRawHeader &header) {
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        return false;
+    }
+    const bool isRead = fread(&header, sizeof(header), 1, fp) == 1;
+    fclose(fp);
+
+    return isRead && memcmp(header._magic, "PMSR", 4) == 0 && header._version == PMS_RAW_VERSION &&
+           header._width > 0 && header._height > 0 && header._channels > 0 &&
+           rawTypeSize(header._dataType) > 0 && header._dataOffset >= sizeof(PMSRawHeader);
+}
+
+#ifdef _WIN32
+PMSMappedFile::PMSMappedFile() : _base(nullptr), _size(0), _file(nullptr), _mapping(nullptr) {}
+#else
+PMSMappedFile::PMSMappedFile() : _base(nullptr), _size(0), _fd(-1) {}
+#endif
+
+PMSMappedFile::~PMSMappedFile() {
+    close();
+}
+
+bool PMSMappedFile::open(const std::string &path) {
+    close();
+    if (!readRawHeader(path, _header)) {
+        return false;
+    }
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    _file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        close();
+        return false;
+    }
+    _size = uint64(size.QuadPart);
+    _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping == nullptr) {
+        close();
+        return false;
+    }
+    _base = static_cast<uint8 *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    _fd = ::open(path.c_str(), O_RDONLY);
+    if (_fd < 0) {
+        return false;
+    }
+    struct stat st{};
+    if (fstat(_fd, &st) != 0) {
+        close();
+        return false;
+    }
+    _size = uint64(st.st_size);
+    void *addr = mmap(nullptr, size_t(_size), PROT_READ, MAP_SHARED, _fd, 0);
+    _base = (addr == MAP_FAILED) ? nullptr : static_cast<uint8 *>(addr);
+#endif
+    if (_base == nullptr) {
+        close();
+        return false;
+    }
+
+    // 文件须包含完整的像素数据
+    const uint64 bytes = uint64(_header._width) * _header._height * _header._channels * rawTypeSize(_header._dataType);
+    if (_header._dataOffset + bytes > _size) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void PMSMappedFile::close() {
+#ifdef _WIN32
+    if (_base != nullptr) {
+        UnmapViewOfFile(_base);
+    }
+    if (_mapping != nullptr) {
+        CloseHandle(_mapping);
+    }
+    if (_file != nullptr) {
+        CloseHandle(_file);
+    }
+    _mapping = nullptr;
+    _file = nullptr;
+#else
+    if (_base != nullptr) {
+        munmap(_base, size_t(_size));
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+    _fd = -1;
+#endif
+    _base = nullptr;
+    _size = 0;
+    _header = PMSRawHeader();
+}
+
+const PMSRawHeader &PMSMappedFile::getHeader() const {
+    return _header;
+}
+
+const uint8 *PMSMappedFile::getData() const {
+    return _base == nullptr ? nullptr : _base + _header._dataOffset;
+}
+
+bool writePlanesPfm(const std::string &path, const DisparityPlane *planes, const sint32 &width, const sint32 &height) {
+    return writePfm(path, reinterpret_cast<const float32 *>(planes), width, height, 3);
+}
+
+bool writePlanesRaw(const std::string &path, const DisparityPlane *planes, const sint32 &width, const sint32 &height) {
+    return writeRaw(path, planes, width, height, 3, PMS_RAW_FLOAT32);
+}
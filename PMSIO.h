@@ -0,0 +1,126 @@
+//
+// Created by tianhe on 2022/9/20.
+//
+
+#ifndef PMSIO_H
+#define PMSIO_H
+
+#include <string>
+
+#include "PMSType.h"
+
+/**
+ * \brief 带文件头的原始数据格式（.pmsraw）
+ * 文件头固定为64字节，其后为按行优先、小端存储的像素数据，各通道交错排列；
+ * 数据起始位置按缓存行对齐，下游程序可直接内存映射文件并以 基址+_dataOffset 访问
+ */
+struct PMSRawHeader {
+    char _magic[4];         // 魔数"PMSR"
+    uint32 _version;        // 格式版本
+    uint32 _width;          // 宽
+    uint32 _height;         // 高
+    uint32 _channels;       // 通道数
+    uint32 _dataType;       // 数据类型，见 PMSRawType
+    uint64 _dataOffset;     // 数据起始字节偏移
+    uint8 _reserved[32];    // 保留，置0
+
+    PMSRawHeader();
+};
+
+/** \brief 原始数据类型 */
+enum PMSRawType : uint32 {
+    PMS_RAW_FLOAT32 = 0,
+    PMS_RAW_UINT8 = 1
+};
+
+/** \brief 原始数据格式的版本 */
+constexpr uint32 PMS_RAW_VERSION = 1;
+
+/**
+ * \brief 写出PFM影像（小端，按PFM约定自下而上逐行写出）
+ * \param path		文件路径
+ * \param data		数据指针，各通道交错排列
+ * \param width		宽
+ * \param height	高
+ * \param channels	通道数，1（Pf）或3（PF）
+ * \return 是否成功
+ */
+bool writePfm(const std::string &path, const float32 *data, const sint32 &width, const sint32 &height,
+              const sint32 &channels = 1);
+
+/**
+ * \brief 写出带文件头的原始数据
+ * \param path		文件路径
+ * \param data		数据指针，各通道交错排列
+ * \param width		宽
+ * \param height	高
+ * \param channels	通道数
+ * \param dataType	数据类型
+ * \return 是否成功
+ */
+bool writeRaw(const std::string &path, const void *data, const sint32 &width, const sint32 &height,
+              const sint32 &channels, const PMSRawType &dataType = PMS_RAW_FLOAT32);
+
+/**
+ * \brief 读取原始数据文件头并检查其有效性
+ * \param path		文件路径
+ * \param header	输出，文件头
+ * \return 是否成功
+ */
+bool readRawHeader(const std::string &path, PMSRawHeader &header);
+
+/**
+ * \brief 只读内存映射的原始数据文件
+ * 映射后数据按需调入内存，适合只访问局部区域的超大影像（如分块匹配的输入）
+ */
+class PMSMappedFile {
+public:
+    PMSMappedFile();
+
+    ~PMSMappedFile();
+
+    PMSMappedFile(const PMSMappedFile &) = delete;
+
+    PMSMappedFile &operator=(const PMSMappedFile &) = delete;
+
+    /**
+     * \brief 打开并映射文件，检查文件头及文件长度
+     * \param path 文件路径
+     * \return 是否成功
+     */
+    bool open(const std::string &path);
+
+    /** \brief 解除映射并关闭文件 */
+    void close();
+
+    /** \brief 文件头 */
+    const PMSRawHeader &getHeader() const;
+
+    /** \brief 像素数据起始地址，未打开时为nullptr */
+    const uint8 *getData() const;
+
+private:
+    /** \brief 文件头 */
+    PMSRawHeader _header;
+
+    /** \brief 映射的起始地址及字节数 */
+    uint8 *_base;
+    uint64 _size;
+
+#ifdef _WIN32
+    /** \brief 文件及映射句柄 */
+    void *_file;
+    void *_mapping;
+#else
+    /** \brief 文件描述符 */
+    sint32 _fd;
+#endif
+};
+
+/** \brief 写出视差平面场（每像素a、b、c三个通道），PFM格式 */
+bool writePlanesPfm(const std::string &path, const DisparityPlane *planes, const sint32 &width, const sint32 &height);
+
+/** \brief 写出视差平面场（每像素a、b、c三个通道），原始数据格式 */
+bool writePlanesRaw(const std::string &path, const DisparityPlane *planes, const sint32 &width, const sint32 &height);
+
+#endif //PMSIO_H
@@ -0,0 +1,44 @@
+//
+// Created by tianhe on 2022/9/28.
+//
+
+#include "PMSImageUtil.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+bool loadImage(const std::string &path, std::vector<uint8> &bytes, sint32 &width, sint32 &height) {
+    cv::Mat img = cv::imread(path, cv::IMREAD_COLOR);
+    if (img.data == nullptr) {
+        return false;
+    }
+    width = static_cast<sint32>(img.cols);
+    height = static_cast<sint32>(img.rows);
+    bytes.resize(size_t(width) * height * 3);
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            const auto &pixel = img.at<cv::Vec3b>(i, j);
+            bytes[i * 3 * width + 3 * j] = pixel[0];
+            bytes[i * 3 * width + 3 * j + 1] = pixel[1];
+            bytes[i * 3 * width + 3 * j + 2] = pixel[2];
+        }
+    }
+    return true;
+}
+
+void dispMatNorm(const sint32 &width, const sint32 &height, const float32 *dispMap, cv::Mat &dispMat) {
+    float32 minDisparity = FLT_MAX, maxDisparity = -FLT_MAX;
+    for (sint32 i = 0; i < width * height; i++) {
+        const float32 disp = std::abs(dispMap[i]);
+        if (disp != Invalid_Float) {
+            minDisparity = std::min(minDisparity, disp);
+            maxDisparity = std::max(maxDisparity, disp);
+        }
+    }
+    const float32 range = std::max(maxDisparity - minDisparity, 1e-6f);
+    for (sint32 i = 0; i < width * height; i++) {
+        const float32 disp = std::abs(dispMap[i]);
+        dispMat.data[i] = (disp == Invalid_Float) ? 0 : static_cast<uchar>((disp - minDisparity) / range * 255);
+    }
+}
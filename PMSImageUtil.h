@@ -0,0 +1,34 @@
+//
+// Created by tianhe on 2022/9/28.
+//
+
+#ifndef PMSIMAGEUTIL_H
+#define PMSIMAGEUTIL_H
+
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "PMSType.h"
+
+/**
+ * \brief 读取影像并转换为3通道字节数据
+ * \param path 影像路径
+ * \param bytes 输出，3通道影像数据
+ * \param width 输出，影像宽
+ * \param height 输出，影像高
+ * \return 是否读取成功
+ */
+bool loadImage(const std::string &path, std::vector<uint8> &bytes, sint32 &width, sint32 &height);
+
+/**
+ * \brief 将视差图归一化为8位影像，无效视差为0
+ * \param width 视差图宽
+ * \param height 视差图高
+ * \param dispMap 视差图
+ * \param dispMat 输出，预先分配的CV_8UC1影像
+ */
+void dispMatNorm(const sint32 &width, const sint32 &height, const float32 *dispMap, cv::Mat &dispMat);
+
+#endif //PMSIMAGEUTIL_H
@@ -0,0 +1,67 @@
+//
+// Created by tianhe on 2022/9/3.
+//
+
+#ifndef PMSPARALLEL_H
+#define PMSPARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "PMSType.h"
+
+/**
+ * \brief 获取实际使用的线程数
+ * \param numThreads	期望线程数，<=0 时取硬件并发线程数
+ * \return 线程数，至少为1
+ */
+inline sint32 resolveThreadCount(const sint32 &numThreads) {
+    if (numThreads > 0) {
+        return numThreads;
+    }
+    const auto hw = static_cast<sint32>(std::thread::hardware_concurrency());
+    return std::max(hw, 1);
+}
+
+/**
+ * \brief 并行执行 [begin, end) 区间内的任务，任务按序号动态分配给各线程
+ * \param begin			起始序号
+ * \param end			结束序号（不含）
+ * \param numThreads	线程数，<=0 时取硬件并发线程数
+ * \param func			任务函数，参数为任务序号和线程序号
+ */
+inline void parallelFor(const sint32 &begin, const sint32 &end, const sint32 &numThreads,
+                        const std::function<void(const sint32 &, const sint32 &)> &func) {
+    if (end <= begin) {
+        return;
+    }
+    const sint32 threads = std::min(resolveThreadCount(numThreads), end - begin);
+    if (threads == 1) {
+        for (sint32 i = begin; i < end; i++) {
+            func(i, 0);
+        }
+        return;
+    }
+
+    std::atomic<sint32> next(begin);
+    auto worker = [&](const sint32 tid) {
+        for (sint32 i = next++; i < end; i = next++) {
+            func(i, tid);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (sint32 t = 1; t < threads; t++) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto &th: pool) {
+        th.join();
+    }
+}
+
+#endif //PMSPARALLEL_H
@@ -0,0 +1,256 @@
+//
+// Created by tianhe on 2022/9/25.
+//
+
+#include "PMSPreprocess.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "CostComputer.hpp"
+
+/** \brief 一行彩色像素转灰度 */
+static void grayRow(const uint8 *color, const sint32 &xBegin, const sint32 &width, uint8 *gray) {
+    for (sint32 x = xBegin; x < width; x++) {
+        const auto b = color[x * 3];
+        const auto g = color[x * 3 + 1];
+        const auto r = color[x * 3 + 2];
+        gray[x] = uint8(r * 0.299 + g * 0.587 + b * 0.114);
+    }
+}
+
+/** \brief 由相邻三行灰度计算中间行[xBegin, width-1)内像素的Sobel梯度 */
+static void sobelRow(const uint8 *row0, const uint8 *row1, const uint8 *row2,
+                     const sint32 &xBegin, const sint32 &width, PGradient *grad) {
+    for (sint32 x = xBegin; x < width - 1; x++) {
+        const auto gradX = (-row0[x - 1] + row0[x + 1]) +
+                           (-2 * row1[x - 1] + 2 * row1[x + 1]) +
+                           (-row2[x - 1] + row2[x + 1]);
+        const auto gradY = (-row0[x - 1] - 2 * row0[x] - row0[x + 1]) +
+                           (row2[x - 1] + 2 * row2[x] + row2[x + 1]);
+        grad[x]._x = sint16(gradX / 8);
+        grad[x]._y = sint16(gradY / 8);
+    }
+}
+
+/**
+ * \brief 由相邻CENSUS_HEIGHT行灰度计算中间行的Census编码，与CostComputerCensus的定义一致
+ * \param rows		各行灰度，超出影像的行已钳制为边界行
+ * \param width		影像宽
+ * \param census	输出，中间行各像素的Census编码
+ */
+static void censusRow(const uint8 *const *rows, const sint32 &width, uint64 *census) {
+    const sint32 halfW = CENSUS_WIDTH / 2;
+    const sint32 halfH = CENSUS_HEIGHT / 2;
+    for (sint32 x = 0; x < width; x++) {
+        const uint8 center = rows[halfH][x];
+        uint64 code = 0;
+        for (sint32 r = 0; r < CENSUS_HEIGHT; r++) {
+            const uint8 *row = rows[r];
+            for (sint32 dx = -halfW; dx <= halfW; dx++) {
+                if (dx == 0 && r == halfH) {
+                    continue;
+                }
+                const sint32 xq = std::min(std::max(x + dx, 0), width - 1);
+                code = (code << 1) | uint64(row[xq] < center);
+            }
+        }
+        census[x] = code;
+    }
+}
+
+#ifdef PMS_USE_AVX2
+/**
+ * \brief 4个像素的灰度，按 (r*0.299 + g*0.587) + b*0.114 的顺序以双精度计算后截断，与标量实现一致
+ * \param b g r 各通道值，32位整数
+ * \return 4个32位整数灰度
+ */
+__attribute__((target("avx2")))
+static inline __m128i gray4AVX2(const __m128i &b, const __m128i &g, const __m128i &r) {
+    const __m256d v = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(r), _mm256_set1_pd(0.299)),
+                                                  _mm256_mul_pd(_mm256_cvtepi32_pd(g), _mm256_set1_pd(0.587))),
+                                    _mm256_mul_pd(_mm256_cvtepi32_pd(b), _mm256_set1_pd(0.114)));
+    return _mm256_cvttpd_epi32(v);
+}
+
+/** \brief 8个像素的灰度，各通道为8个32位整数 */
+__attribute__((target("avx2")))
+static inline __m128i gray8AVX2(const __m256i &b, const __m256i &g, const __m256i &r) {
+    const __m128i lo = gray4AVX2(_mm256_castsi256_si128(b), _mm256_castsi256_si128(g), _mm256_castsi256_si128(r));
+    const __m128i hi = gray4AVX2(_mm256_extracti128_si256(b, 1), _mm256_extracti128_si256(g, 1),
+                                 _mm256_extracti128_si256(r, 1));
+    return _mm_packs_epi32(lo, hi);
+}
+
+/** \brief 一行彩色像素转灰度（AVX2实现，每次处理16个像素），尾部交由标量实现 */
+__attribute__((target("avx2")))
+static void grayRowAVX2(const uint8 *color, const sint32 &width, uint8 *gray) {
+    // 解交织掩码：16个像素占48字节，第c通道第k个像素位于第 3k+c 字节，分属三个16字节块
+    alignas(16) sint8 table[3][3][16];
+    for (sint32 c = 0; c < 3; c++) {
+        for (sint32 s = 0; s < 3; s++) {
+            for (sint32 k = 0; k < 16; k++) {
+                const sint32 pos = 3 * k + c;
+                table[c][s][k] = sint8(pos / 16 == s ? pos % 16 : -1);
+            }
+        }
+    }
+    __m128i masks[3][3];
+    for (sint32 c = 0; c < 3; c++) {
+        for (sint32 s = 0; s < 3; s++) {
+            masks[c][s] = _mm_load_si128(reinterpret_cast<const __m128i *>(table[c][s]));
+        }
+    }
+
+    sint32 x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const auto *src = reinterpret_cast<const __m128i *>(color + x * 3);
+        const __m128i v0 = _mm_loadu_si128(src);
+        const __m128i v1 = _mm_loadu_si128(src + 1);
+        const __m128i v2 = _mm_loadu_si128(src + 2);
+        __m128i ch[3];
+        for (sint32 c = 0; c < 3; c++) {
+            ch[c] = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, masks[c][0]), _mm_shuffle_epi8(v1, masks[c][1])),
+                                 _mm_shuffle_epi8(v2, masks[c][2]));
+        }
+
+        // 前8个及后8个像素分别扩展为32位整数
+        const __m128i lo = gray8AVX2(_mm256_cvtepu8_epi32(ch[0]), _mm256_cvtepu8_epi32(ch[1]),
+                                     _mm256_cvtepu8_epi32(ch[2]));
+        const __m128i hi = gray8AVX2(_mm256_cvtepu8_epi32(_mm_unpackhi_epi64(ch[0], ch[0])),
+                                     _mm256_cvtepu8_epi32(_mm_unpackhi_epi64(ch[1], ch[1])),
+                                     _mm256_cvtepu8_epi32(_mm_unpackhi_epi64(ch[2], ch[2])));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(gray + x), _mm_packus_epi16(lo, hi));
+    }
+    grayRow(color, x, width, gray);
+}
+
+/** \brief 读取16个灰度并扩展为16位整数 */
+__attribute__((target("avx2")))
+static inline __m256i loadGrayAVX2(const uint8 *gray) {
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(gray)));
+}
+
+/** \brief 16位有符号整数除以8，向零取整 */
+__attribute__((target("avx2")))
+static inline __m256i divide8AVX2(const __m256i &v) {
+    const __m256i bias = _mm256_and_si256(_mm256_srai_epi16(v, 15), _mm256_set1_epi16(7));
+    return _mm256_srai_epi16(_mm256_add_epi16(v, bias), 3);
+}
+
+/** \brief 由相邻三行灰度计算中间行的Sobel梯度（AVX2实现，每次处理16个像素），尾部交由标量实现 */
+__attribute__((target("avx2")))
+static void sobelRowAVX2(const uint8 *row0, const uint8 *row1, const uint8 *row2,
+                         const sint32 &width, PGradient *grad) {
+    sint32 x = 1;
+    for (; x + 16 <= width - 1; x += 16) {
+        const __m256i a0 = loadGrayAVX2(row0 + x - 1);
+        const __m256i b0 = loadGrayAVX2(row0 + x);
+        const __m256i c0 = loadGrayAVX2(row0 + x + 1);
+        const __m256i a1 = loadGrayAVX2(row1 + x - 1);
+        const __m256i c1 = loadGrayAVX2(row1 + x + 1);
+        const __m256i a2 = loadGrayAVX2(row2 + x - 1);
+        const __m256i b2 = loadGrayAVX2(row2 + x);
+        const __m256i c2 = loadGrayAVX2(row2 + x + 1);
+
+        // 整数运算与求值顺序无关，|响应| <= 1020，16位不溢出
+        const __m256i gx = _mm256_add_epi16(_mm256_add_epi16(_mm256_sub_epi16(c0, a0),
+                                                             _mm256_slli_epi16(_mm256_sub_epi16(c1, a1), 1)),
+                                            _mm256_sub_epi16(c2, a2));
+        const __m256i gy = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(a2, _mm256_slli_epi16(b2, 1)), c2),
+                                            _mm256_add_epi16(_mm256_add_epi16(a0, _mm256_slli_epi16(b0, 1)), c0));
+        const __m256i qx = divide8AVX2(gx);
+        const __m256i qy = divide8AVX2(gy);
+
+        // 交织为(x, y)对；unpack在128位内进行，再跨128位重排为像素顺序
+        const __m256i lo = _mm256_unpacklo_epi16(qx, qy);
+        const __m256i hi = _mm256_unpackhi_epi16(qx, qy);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(grad + x), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(grad + x + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    sobelRow(row0, row1, row2, x, width, grad);
+}
+#endif
+
+void computeGradientBand(const uint8 *img, const sint32 &width, const sint32 &height,
+                         const sint32 &yBegin, const sint32 &yEnd,
+                         PGradient *grad, uint8 *gray, uint64 *census, const bool &isUseSimd) {
+    if (img == nullptr || grad == nullptr || width <= 0 || height <= 0 || yBegin >= yEnd) {
+        return;
+    }
+
+#ifdef PMS_USE_AVX2
+    const bool isSimd = isUseSimd && CostComputerPMS::isSimdSupported();
+#else
+    const bool isSimd = false;
+#endif
+
+    // 滚动的灰度缓冲，第y行存放在第 y%numRows 行；计算Census时需保留其窗口内的全部行
+    const sint32 halfH = CENSUS_HEIGHT / 2;
+    const sint32 numRows = (census != nullptr) ? CENSUS_HEIGHT : 3;
+    const sint32 margin = (census != nullptr) ? halfH : 1;
+    std::vector<uint8> ring(size_t(width) * numRows);
+    const auto grayAt = [&](const sint32 &y) {
+        return ring.data() + size_t(y % numRows) * width;
+    };
+
+    // 第yc行的Census编码，窗口超出影像的行取边界行
+    const auto censusAt = [&](const sint32 &yc) {
+        const uint8 *rows[CENSUS_HEIGHT];
+        for (sint32 r = 0; r < CENSUS_HEIGHT; r++) {
+            rows[r] = grayAt(std::min(std::max(yc + r - halfH, 0), height - 1));
+        }
+        censusRow(rows, width, census + size_t(yc) * width);
+    };
+
+    const sint32 gBegin = std::max(yBegin - margin, 0);
+    const sint32 gEnd = std::min(yEnd + margin, height);
+    for (sint32 yg = gBegin; yg < gEnd; yg++) {
+        uint8 *row = grayAt(yg);
+        const uint8 *color = img + size_t(yg) * width * 3;
+#ifdef PMS_USE_AVX2
+        if (isSimd) {
+            grayRowAVX2(color, width, row);
+        } else
+#endif
+        {
+            grayRow(color, 0, width, row);
+        }
+        if (gray != nullptr && yg >= yBegin && yg < yEnd) {
+            memcpy(gray + size_t(yg) * width, row, width);
+        }
+
+        // 第yg行灰度就绪后，第yg-halfH行的Census窗口齐备；最后一行就绪后其余各行均齐备
+        if (census != nullptr) {
+            const sint32 ycBegin = std::max(yg - halfH, yBegin);
+            const sint32 ycEnd = (yg == height - 1) ? yEnd : std::min(yg - halfH + 1, yEnd);
+            for (sint32 yc = ycBegin; yc < ycEnd; yc++) {
+                censusAt(yc);
+            }
+        }
+
+        // 第yg行灰度就绪后，第yg-1行的三行邻域齐备
+        const sint32 y = yg - 1;
+        if (y < yBegin || y >= yEnd || y < 1 || y >= height - 1) {
+            continue;
+        }
+        PGradient *gradRow = grad + size_t(y) * width;
+        gradRow[0] = gradRow[width - 1] = PGradient();
+#ifdef PMS_USE_AVX2
+        if (isSimd) {
+            sobelRowAVX2(grayAt(y - 1), grayAt(y), grayAt(y + 1), width, gradRow);
+        } else
+#endif
+        {
+            sobelRow(grayAt(y - 1), grayAt(y), grayAt(y + 1), 1, width, gradRow);
+        }
+    }
+
+    // 首尾两行梯度为0
+    for (const sint32 y: {0, height - 1}) {
+        if (y >= yBegin && y < yEnd) {
+            std::fill(grad + size_t(y) * width, grad + size_t(y + 1) * width, PGradient());
+        }
+    }
+}
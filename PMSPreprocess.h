@@ -0,0 +1,33 @@
+//
+// Created by tianhe on 2022/9/25.
+//
+
+#ifndef PMSPREPROCESS_H
+#define PMSPREPROCESS_H
+
+#include "PMSType.h"
+
+/** \brief 预处理任务的行带高度：每条行带独立计算，行带间只重复计算上下各一行（计算Census时为CENSUS_HEIGHT/2行）灰度 */
+constexpr sint32 PREPROCESS_BAND_HEIGHT = 32;
+
+/**
+ * \brief 计算彩色影像一条行带的Sobel梯度及Census编码，灰度转换、梯度及Census变换融合为一遍
+ * 行带内逐行将彩色转为灰度，灰度只保存在滚动的行缓冲中，凑齐三行即计算中间行的梯度，
+ * 凑齐CENSUS_HEIGHT行即计算中间行的Census编码（与CostComputerCensus的定义一致）。
+ * 结果与先整幅转灰度再计算梯度逐位一致：灰度为 uint8(r*0.299 + g*0.587 + b*0.114)，
+ * 梯度为Sobel响应除以8取整，影像四周一像素宽的边界梯度为0
+ * \param img		影像数据，3通道
+ * \param width		影像宽
+ * \param height	影像高
+ * \param yBegin	行带起始行
+ * \param yEnd		行带结束行（不含）
+ * \param grad		输出，梯度数据（整幅）
+ * \param gray		输出，灰度数据（整幅），nullptr表示不输出
+ * \param census	输出，Census编码（整幅），nullptr表示不计算
+ * \param isUseSimd	是否使用SIMD实现，仅在CPU支持AVX2时生效
+ */
+void computeGradientBand(const uint8 *img, const sint32 &width, const sint32 &height,
+                         const sint32 &yBegin, const sint32 &yEnd,
+                         PGradient *grad, uint8 *gray, uint64 *census, const bool &isUseSimd);
+
+#endif //PMSPREPROCESS_H
@@ -3,23 +3,49 @@
 //
 
 #include "PMSPropagation.h"
-
-#define SAFE_DELETE(P) if(P!=nullptr){delete(P); (P)=nullptr;}
-
-PMSPropagation::PMSPropagation(const PMSOption &option,
-                               const sint32 &width, const sint32 &height,
-                               const uint8 *imgLeft, const uint8 *imgRight,
-                               const PGradient *gradLeft, const PGradient *gradRight,
-                               DisparityPlane *planeLeft, DisparityPlane *planeRight,
-                               float32 *costLeft, float32 *costRight,
-                               float32 *disparityMap) {
+#include <algorithm>
+
+/**
+ * \brief 棋盘格模式的邻域偏移(dx, dy)
+ * 偏移量的曼哈顿距离均为奇数，保证邻域像素与当前像素异色，同色像素可安全并行更新
+ */
+static const sint32 CHECKERBOARD_NEIGHBORS[][2] = {
+        {-1, 0}, {1, 0}, {0, -1}, {0, 1},
+        {-3, 0}, {3, 0}, {0, -3}, {0, 3},
+        {-5, 0}, {5, 0}, {0, -5}, {0, 5}
+};
+
+/** \brief 活动集判定阈值：平面在Patch范围内的最大视差变化不超过该值时视为未变化，与平面优化的终止阈值一致 */
+static const float32 ACTIVE_SET_DISP_THRES = 0.1f;
+
+/**
+ * \brief 活动集判定的邻域偏移(dx, dy)
+ * 棋盘格模式的远距离候选只用于加速传播，仅以四邻域判定即可
+ */
+static const sint32 ACTIVE_SET_NEIGHBORS[][2] = {
+        {-1, 0}, {1, 0}, {0, -1}, {0, 1}
+};
+
+/** \brief 时序传播的邻域偏移(dx, dy)，上一帧同位置及四邻域像素，兼顾小幅运动 */
+static const sint32 TEMPORAL_NEIGHBORS[][2] = {
+        {0, 0}, {-1, 0}, {1, 0}, {0, -1}, {0, 1}
+};
+
+template<typename Policy>
+PMSPropagation<Policy>::PMSPropagation(const PMSOption &option,
+                                       const PMSCostInput &inputLeft, const PMSCostInput &inputRight,
+                                       DisparityPlane *planeLeft, DisparityPlane *planeRight,
+                                       float32 *costLeft, float32 *costRight,
+                                       float32 *disparityMap) :
+        _costCptLeft(Policy::createCostComputer(option, inputLeft)),
+        _costCptRight(Policy::createCostComputer(option, inputRight)) {
     _option = option;
-    _width = width;
-    _height = height;
-    _imgLeft = imgLeft;
-    _imgRight = imgRight;
-    _gradLeft = gradLeft;
-    _gradRight = gradRight;
+    _width = inputLeft._width;
+    _height = inputLeft._height;
+    _imgLeft = inputLeft._imgLeft;
+    _imgRight = inputLeft._imgRight;
+    _gradLeft = inputLeft._gradLeft;
+    _gradRight = inputLeft._gradRight;
     _planeLeft = planeLeft;
     _planeRight = planeRight;
     _costLeft = costLeft;
@@ -27,91 +53,245 @@ PMSPropagation::PMSPropagation(const PMSOption &option,
     _disparityMap = disparityMap;
 
     _numIter = 0;
-
-    _costCptLeft = new CostComputerPMS(imgLeft, imgRight,
-                                       gradLeft, gradRight,
-                                       width, height,
-                                       option._patchSize,
-                                       option._minDisparity, option._maxDisparity,
-                                       option._gamma, option._alpha, option._tauCol, option._tauGrad
-    );
-
-    _costCptRight = new CostComputerPMS(imgRight, imgLeft,
-                                        gradRight, gradLeft,
-                                        width, height,
-                                        option._patchSize,
-                                        -option._maxDisparity, -option._minDisparity,
-                                        option._gamma, option._alpha, option._tauCol, option._tauGrad);
-
-    // 随机数生成器
-    _randDisp = new std::uniform_real_distribution<float32>(-1.0f, 1.0f);
-    _randNorm = new std::uniform_real_distribution<float32>(-1.0f, 1.0f);
+    _activeRatio = 1.0f;
+    _threadStats.resize(option._isCheckerboard ? resolveThreadCount(option._numThreads) : 1);
 
     // 计算初始代价数据
     computeCostData();
 }
 
-PMSPropagation::~PMSPropagation() {
-    SAFE_DELETE(_costCptLeft);
-    SAFE_DELETE(_costCptRight);
-    SAFE_DELETE(_randDisp);
-    SAFE_DELETE(_randNorm);
-}
-
-void PMSPropagation::computeCostData() {
-    if (_costCptLeft == nullptr || _costCptRight == nullptr ||
-        _imgLeft == nullptr || _imgRight == nullptr ||
+template<typename Policy>
+void PMSPropagation<Policy>::computeCostData() {
+    if (_imgLeft == nullptr || _imgRight == nullptr ||
         _gradLeft == nullptr || _gradRight == nullptr ||
-        _planeLeft == nullptr || _planeRight == nullptr ||
+        _planeLeft == nullptr ||
         _costLeft == nullptr || _disparityMap == nullptr) {
         return;
     }
 
-    auto *costCpt = dynamic_cast<CostComputerPMS *>(_costCptLeft);
+    // 每个像素只写入自身代价，棋盘格模式下各行并行计算，结果与串行一致
+    const sint32 numThreads = _option._isCheckerboard ? _option._numThreads : 1;
+    parallelFor(0, _height, numThreads, [&](const sint32 &y, const sint32 &tid) {
+        for (sint32 x = 0; x < _width; x++) {
+            DisparityPlane planeP = _planeLeft[y * _width + x];
+            _costLeft[y * _width + x] = _costCptLeft.template computeAggregation<PatchSize>(x, y, planeP);
+        }
+        _threadStats[tid]._numEvaluations += uint64(_width);
+    });
+}
+
+template<typename Policy>
+PMSStatistics PMSPropagation<Policy>::getStatistics() const {
+    PMSStatistics stats;
+    for (const auto &s: _threadStats) {
+        stats += s;
+    }
+    return stats;
+}
+
+template<typename Policy>
+float32 PMSPropagation<Policy>::getActiveRatio() const {
+    return _activeRatio;
+}
+
+template<typename Policy>
+void PMSPropagation<Policy>::doPixelStep(const PixelStep &step, const sint32 &x, const sint32 &y,
+                                         const sint32 &direction, PMSStatistics &stats) {
+    if (step == PixelStep::SpatialPropagation) {
+        spatialPropagation(x, y, direction, stats);
+    } else {
+        planeRefine(x, y, stats);
+    }
+}
 
+template<typename Policy>
+void PMSPropagation<Policy>::updateActiveSet() {
+    const sint32 size = _width * _height;
+    if (_planeSnapshot.empty()) {
+        // 首轮迭代所有像素均为活动像素
+        _planeSnapshot.assign(_planeLeft, _planeLeft + size);
+        _dirty.assign(size, 1);
+        return;
+    }
+    // 与上一轮开始时的快照比较，同时覆盖本视图的更新和另一视图视图传播写入的平面
     for (sint32 y = 0; y < _height; y++) {
         for (sint32 x = 0; x < _width; x++) {
-            DisparityPlane planeP = _planeLeft[y * _width + x];
-            _costLeft[y * _width + x] = costCpt->computeAggregation(x, y, planeP);
+            const sint32 p = y * _width + x;
+            _dirty[p] = isPlaneChanged(_planeSnapshot[p], _planeLeft[p], x, y) ? 1 : 0;
         }
     }
+    std::copy(_planeLeft, _planeLeft + size, _planeSnapshot.begin());
+}
+
+template<typename Policy>
+bool PMSPropagation<Policy>::isPlaneChanged(const DisparityPlane &planeOld, const DisparityPlane &planeNew,
+                                            const sint32 &x, const sint32 &y) const {
+    const float32 half = float32(_option._patchSize / 2);
+    const float32 diff = std::abs(planeNew.getDisparity(x, y) - planeOld.getDisparity(x, y)) +
+                         (std::abs(planeNew._p._x - planeOld._p._x) + std::abs(planeNew._p._y - planeOld._p._y)) * half;
+    return diff > ACTIVE_SET_DISP_THRES;
 }
 
-void PMSPropagation::doPropagation() {
-    if (_costCptLeft == nullptr || _costCptRight == nullptr ||
-        _imgLeft == nullptr || _imgRight == nullptr ||
+template<typename Policy>
+bool PMSPropagation<Policy>::isActive(const sint32 &x, const sint32 &y) const {
+    if (_dirty.empty() || _dirty[y * _width + x]) {
+        return true;
+    }
+    for (const auto &offset: ACTIVE_SET_NEIGHBORS) {
+        const sint32 xd = x + offset[0];
+        const sint32 yd = y + offset[1];
+        if (xd >= 0 && xd < _width && yd >= 0 && yd < _height && _dirty[yd * _width + xd]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename Policy>
+void PMSPropagation<Policy>::doPropagation() {
+    if (_imgLeft == nullptr || _imgRight == nullptr ||
         _gradLeft == nullptr || _gradRight == nullptr ||
-        _planeLeft == nullptr || _planeRight == nullptr ||
+        _planeLeft == nullptr ||
         _costLeft == nullptr || _disparityMap == nullptr) {
         return;
     }
 
+    // 活动集：跳过自身及邻域平面均未变化的已收敛像素
+    if (_option._isUseActiveSet) {
+        updateActiveSet();
+    }
+    const uint64 numProcessed = getStatistics()._numProcessed;
+
+    if (_option._isCheckerboard) {
+        doCheckerboardPropagation();
+    } else {
+        doSequentialPropagation();
+    }
+    ++_numIter;
+
+    _activeRatio = float32(getStatistics()._numProcessed - numProcessed) / float32(_width * _height);
+}
+
+template<typename Policy>
+void PMSPropagation<Policy>::doTemporalPropagation(const DisparityPlane *planePrev) {
+    if (planePrev == nullptr || _imgLeft == nullptr || _imgRight == nullptr ||
+        _gradLeft == nullptr || _gradRight == nullptr ||
+        _planeLeft == nullptr || _costLeft == nullptr) {
+        return;
+    }
+
+    // 每个像素只读取上一帧平面、只写入自身平面，各行可并行处理
+    const sint32 numThreads = _option._isCheckerboard ? _option._numThreads : 1;
+    parallelFor(0, _height, numThreads, [&](const sint32 &y, const sint32 &tid) {
+        // 行内累加到局部统计量，每行合并一次，避免相邻线程的统计量共享缓存行
+        PMSStatistics stats;
+        for (sint32 x = 0; x < _width; x++) {
+            const auto &planeP = _planeLeft[y * _width + x];
+
+            DisparityPlane candidates[MAX_AGGREGATION_BATCH];
+            sint32 num = 0;
+            for (const auto &offset: TEMPORAL_NEIGHBORS) {
+                const sint32 xd = x + offset[0];
+                const sint32 yd = y + offset[1];
+                if (xd < 0 || xd >= _width || yd < 0 || yd >= _height) {
+                    continue;
+                }
+                addCandidate(planePrev[yd * _width + xd], planeP, candidates, num);
+            }
+
+            selectBestPlane(x, y, candidates, num, stats);
+        }
+        _threadStats[tid] += stats;
+    });
+}
+
+template<typename Policy>
+void PMSPropagation<Policy>::doSequentialPropagation() {
     // 偶数次迭代从左上到右下传播
     // 奇数次迭代从右下到左上传播
+    auto &stats = _threadStats[0];
     const sint32 dir = (_numIter % 2 == 0) ? 1 : -1;
     sint32 y = (dir == 1) ? 0 : _height - 1;
     for (sint32 i = 0; i < _height; i++) {
         sint32 x = (dir == 1) ? 0 : _width - 1;
-        for (sint32 j = 0; j < _width; j++) {
+        for (sint32 j = 0; j < _width; j++, x += dir) {
+            if (!isActive(x, y)) {
+                continue;
+            }
+            stats._numProcessed++;
 
             // 空间传播
-            spatialPropagation(x, y, dir);
+            spatialPropagation(x, y, dir, stats);
 
             // 平面优化
-            if (!_option._isForceFpw) {
-                planeRefine(x, y);
+            if (!IsForceFpw) {
+                planeRefine(x, y, stats);
             }
 
-            viewPropagation(x, y);
-
-            x += dir;
+            viewPropagation(x, y, stats);
         }
         y += dir;
     }
-    ++_numIter;
 }
 
-void PMSPropagation::spatialPropagation(const sint32 &x, const sint32 &y, const sint32 &direction) {
+template<typename Policy>
+void PMSPropagation<Policy>::doCheckerboardPropagation() {
+    // 红色像素: (x + y) 为偶数; 黑色像素: (x + y) 为奇数
+    // 同一行由同一线程处理，视图传播只会写入另一视图的同一行，因此行间无写冲突
+    for (sint32 color = 0; color < 2; color++) {
+        parallelFor(0, _height, _option._numThreads, [&](const sint32 &y, const sint32 &tid) {
+            // 行内累加到局部统计量，每行合并一次，避免相邻线程的统计量共享缓存行
+            PMSStatistics stats;
+            for (sint32 x = (y + color) % 2; x < _width; x += 2) {
+                if (!isActive(x, y)) {
+                    continue;
+                }
+                stats._numProcessed++;
+
+                // 空间传播
+                checkerboardSpatialPropagation(x, y, stats);
+
+                // 平面优化
+                if (!IsForceFpw) {
+                    planeRefine(x, y, stats);
+                }
+
+                viewPropagation(x, y, stats);
+            }
+            _threadStats[tid] += stats;
+        });
+    }
+}
+
+template<typename Policy>
+void PMSPropagation<Policy>::checkerboardSpatialPropagation(const sint32 &x, const sint32 &y,
+                                                            PMSStatistics &stats) {
+    const auto &planeP = _planeLeft[y * _width + x];
+
+    // 收集各异色邻域像素的视差平面作为候选，批量计算代价后取最小者
+    DisparityPlane candidates[MAX_AGGREGATION_BATCH];
+    sint32 num = 0;
+    for (const auto &offset: CHECKERBOARD_NEIGHBORS) {
+        const sint32 xd = x + offset[0];
+        const sint32 yd = y + offset[1];
+        if (xd < 0 || xd >= _width || yd < 0 || yd >= _height) {
+            continue;
+        }
+        addCandidate(_planeLeft[yd * _width + xd], planeP, candidates, num);
+    }
+
+    if (num > 0) {
+        if (selectBestPlane(x, y, candidates, num, stats) >= 0) {
+            stats._numSpatialAccepted++;
+        } else {
+            stats._numSpatialRejected++;
+        }
+    }
+}
+
+template<typename Policy>
+void PMSPropagation<Policy>::spatialPropagation(const sint32 &x, const sint32 &y, const sint32 &direction,
+                                                PMSStatistics &stats) {
     // ---
     // 空间传播
 
@@ -119,45 +299,42 @@ void PMSPropagation::spatialPropagation(const sint32 &x, const sint32 &y, const
     // 奇数次迭代从右下到左上传播
     const sint32 dir = direction;
 
-    // 获取p当前的视差平面并计算代价
-    auto &planeP = _planeLeft[y * _width + x];
-    auto &costP = _costLeft[y * _width + x];
-    auto *costCpt = dynamic_cast<CostComputerPMS *>(_costCptLeft);
+    // 获取p当前的视差平面
+    const auto &planeP = _planeLeft[y * _width + x];
 
-    // 获取p左(右)侧像素的视差平面，计算将平面分配给p时的代价，取较小值
+    DisparityPlane candidates[2];
+    sint32 num = 0;
+
+    // 获取p左(右)侧像素的视差平面
     const sint32 xd = x - dir;
     if (xd >= 0 && xd < _width) {
-        auto &plane = _planeLeft[y * _width + xd];
-        if (plane != planeP) {
-            const auto cost = costCpt->computeAggregation(x, y, plane);
-            if (cost < costP) {
-                planeP = plane;
-                costP = cost;
-            }
-        }
+        addCandidate(_planeLeft[y * _width + xd], planeP, candidates, num);
     }
 
-    // 获取p上(下)侧像素的视差平面，计算将平面分配给p时的代价，取较小值
+    // 获取p上(下)侧像素的视差平面
     const sint32 yd = y - dir;
     if (yd >= 0 && yd < _height) {
-        auto &plane = _planeLeft[yd * _width + x];
-        if (plane != planeP) {
-            const auto cost = costCpt->computeAggregation(x, y, plane);
-            if (cost < costP) {
-                planeP = plane;
-                costP = cost;
-            }
+        addCandidate(_planeLeft[yd * _width + x], planeP, candidates, num);
+    }
+
+    // 计算将平面分配给p时的代价，取较小值
+    if (num > 0) {
+        if (selectBestPlane(x, y, candidates, num, stats) >= 0) {
+            stats._numSpatialAccepted++;
+        } else {
+            stats._numSpatialRejected++;
         }
     }
 }
 
-void PMSPropagation::planeRefine(const sint32 &x, const sint32 &y) {
+template<typename Policy>
+void PMSPropagation<Policy>::planeRefine(const sint32 &x, const sint32 &y,
+                                         PMSStatistics &stats) {
     auto minDisparity = _option._minDisparity;
     auto maxDisparity = _option._maxDisparity;
 
-    // 像素p的平面、代价、视差、法线
-    auto &planeP = _planeLeft[y * _width + x];
-    auto &costP = _costLeft[y * _width + x];
+    // 像素p的平面、视差、法线
+    const auto &planeP = _planeLeft[y * _width + x];
     float32 dispP = planeP.getDisparity(x, y);
     PVector3f normP = planeP.getNormal();
 
@@ -166,25 +343,21 @@ void PMSPropagation::planeRefine(const sint32 &x, const sint32 &y) {
     float32 normUpdate = 1.0f;
     const float32 stopThres = 0.1f;
 
-    // 代价计算器
-    auto *costCpt = dynamic_cast<CostComputerPMS *>(_costCptLeft);
+    // 随机数生成器，由种子、迭代次数及像素位置确定，与线程划分无关
+    PMSRandom rng(_option._seed, PMSRandom::makeKey(uint32(_numIter), uint32(y * _width + x)));
 
-    // 随机数生成器
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    auto &randDisp = *_randDisp;
-    auto &randNorm = *_randNorm;
-
-    // 迭代优化
+    // 以逐次减半的扰动幅度在p的当前平面附近生成候选平面，由粗到精：
+    // 每个候选单独计算代价（以p当前代价为上界），被采纳后以其视差、法线作为下一次扰动的中心
     while (dispUpdate > stopThres) {
         // 在 -disp_update ~ disp_update 范围内随机一个视差增量
-        float32 dispRd = randDisp(gen) * dispUpdate;
-        if (_option._isIntegerDisp) {
+        float32 dispRd = rng.uniform(-1.0f, 1.0f) * dispUpdate;
+        if (IsIntegerDisp) {
             dispRd = static_cast<float32>(round(dispRd));
         }
 
         float32 dispPNew = dispP + dispRd;
         if (dispPNew < float32(minDisparity) || dispPNew > float32(maxDisparity)) {
+            stats._numRefineOutOfRange++;
             dispUpdate /= 2.0f;
             normUpdate /= 2.0f;
             continue;
@@ -192,12 +365,12 @@ void PMSPropagation::planeRefine(const sint32 &x, const sint32 &y) {
 
         // 在 -norm_update ~ norm_update 范围内随机三个值作为法线增量的三个分量
         PVector3f normRd;
-        if (!_option._isForceFpw) {
-            normRd._x = randNorm(gen) * normUpdate;
-            normRd._y = randNorm(gen) * normUpdate;
-            float32 z = randNorm(gen) * normUpdate;
+        if (!IsForceFpw) {
+            normRd._x = rng.uniform(-1.0f, 1.0f) * normUpdate;
+            normRd._y = rng.uniform(-1.0f, 1.0f) * normUpdate;
+            float32 z = rng.uniform(-1.0f, 1.0f) * normUpdate;
             while (z == 0.0f) {
-                z = randNorm(gen) * normUpdate;
+                z = rng.uniform(-1.0f, 1.0f) * normUpdate;
             }
             normRd._z = z;
         } else {
@@ -209,17 +382,15 @@ void PMSPropagation::planeRefine(const sint32 &x, const sint32 &y) {
         auto normPNew = normP + normRd;
         normPNew.normalize();
 
-        // 计算新的视差平面
-        auto planeNew = DisparityPlane(x, y, normPNew, dispPNew);
-
-        // 比较Cost
+        // 计算新的视差平面，比较Cost
+        const DisparityPlane planeNew(x, y, normPNew, dispPNew);
         if (planeNew != planeP) {
-            float32 cost = costCpt->computeAggregation(x, y, planeNew);
-            if (cost < costP) {
-                planeP = planeNew;
-                costP = cost;
+            if (selectBestPlane(x, y, &planeNew, 1, stats) >= 0) {
+                stats._numRefineAccepted++;
                 dispP = dispPNew;
                 normP = normPNew;
+            } else {
+                stats._numRefineRejected++;
             }
         }
 
@@ -228,18 +399,69 @@ void PMSPropagation::planeRefine(const sint32 &x, const sint32 &y) {
     }
 }
 
-void PMSPropagation::viewPropagation(const sint32 &x, const sint32 &y) {
+template<typename Policy>
+void PMSPropagation<Policy>::addCandidate(const DisparityPlane &plane, const DisparityPlane &planeP,
+                                          DisparityPlane *candidates, sint32 &num) {
+    if (plane == planeP) {
+        return;
+    }
+    for (sint32 k = 0; k < num; k++) {
+        if (candidates[k] == plane) {
+            return;
+        }
+    }
+    candidates[num++] = plane;
+}
+
+template<typename Policy>
+sint32 PMSPropagation<Policy>::selectBestPlane(const sint32 &x, const sint32 &y,
+                                               const DisparityPlane *candidates, const sint32 &num,
+                                               PMSStatistics &stats) {
+    if (num <= 0) {
+        return -1;
+    }
+
+    auto &planeP = _planeLeft[y * _width + x];
+    auto &costP = _costLeft[y * _width + x];
+    // 以p当前代价为上界，代价必然更大的候选提前终止计算
+    float32 costs[MAX_AGGREGATION_BATCH];
+    stats._numPruned += _costCptLeft.template computeAggregationBatch<PatchSize>(x, y, candidates, num, costs, costP);
+    stats._numEvaluations += num;
+
+    // 按候选顺序依次比较，与逐个计算时的更新结果一致
+    sint32 best = -1;
+    for (sint32 k = 0; k < num; k++) {
+        if (costs[k] < costP) {
+            costP = costs[k];
+            best = k;
+        }
+    }
+    if (best >= 0) {
+        if (!_dirty.empty() && isPlaneChanged(planeP, candidates[best], x, y)) {
+            _dirty[y * _width + x] = 1;
+        }
+        planeP = candidates[best];
+    }
+    return best;
+}
+
+template<typename Policy>
+void PMSPropagation<Policy>::viewPropagation(const sint32 &x, const sint32 &y,
+                                             PMSStatistics &stats) {
     // --
     // 视图传播
     // 搜索p在右视图的同名点q，更新q的平面
 
+    // 只计算左视图时没有右视图数据
+    if (_planeRight == nullptr || _costRight == nullptr) {
+        return;
+    }
+
     // 左视图匹配点p的位置及其视差平面
     const sint32 p = y * _width + x;
     const auto &planeP = _planeLeft[p];
     const float32 dispP = planeP.getDisparity(x, y);
 
-    auto *costCpt = dynamic_cast<CostComputerPMS *>(_costCptRight);
-
     // 计算右视图列号
     const sint32 xr = std::lround(float32(x) - dispP);
     if (xr < 0 || xr >= _width) {
@@ -253,9 +475,28 @@ void PMSPropagation::viewPropagation(const sint32 &x, const sint32 &y) {
     // 将左视图的视差平面转换到右视图
     const auto planeP2Q = planeP.toAnotherView(x, y);
     const float32 dispQ = planeP2Q.getDisparity(xr, y);
-    const auto cost = costCpt->computeAggregation(xr, y, planeP2Q);
+    float32 cost;
+    stats._numPruned += _costCptRight.template computeAggregationBatch<PatchSize>(xr, y, &planeP2Q, 1, &cost, costQ);
+    stats._numEvaluations++;
     if (cost < costQ) {
         planeQ = planeP2Q;
         costQ = cost;
+        stats._numViewAccepted++;
+    } else {
+        stats._numViewRejected++;
     }
 }
+
+// 显式实例化：Patch尺寸为0时由运行期参数指定，其余为编译期特化的常用尺寸
+#define PMS_INSTANTIATE_PROPAGATION(CostCpt, PatchSize) \
+    template class PMSPropagation<PMSPolicy<CostCpt, PatchSize, false, false>>; \
+    template class PMSPropagation<PMSPolicy<CostCpt, PatchSize, false, true>>; \
+    template class PMSPropagation<PMSPolicy<CostCpt, PatchSize, true, false>>; \
+    template class PMSPropagation<PMSPolicy<CostCpt, PatchSize, true, true>>;
+
+PMS_INSTANTIATE_PROPAGATION(CostComputerPMS, 0)
+PMS_INSTANTIATE_PROPAGATION(CostComputerPMS, 21)
+PMS_INSTANTIATE_PROPAGATION(CostComputerPMS, 35)
+PMS_INSTANTIATE_PROPAGATION(CostComputerCensus, 0)
+PMS_INSTANTIATE_PROPAGATION(CostComputerCensus, 21)
+PMS_INSTANTIATE_PROPAGATION(CostComputerCensus, 35)
@@ -6,28 +6,88 @@
 #define PMSPROPAGATION_H
 
 
-#include <random>
 #include <cmath>
 #include "PMSType.h"
 #include "CostComputer.hpp"
+#include "PMSParallel.h"
+#include "PMSRandom.h"
+
+/**
+ * \brief 传播策略：在编译期确定代价计算器类型、Patch尺寸及平面约束
+ * 传播引擎以策略为模板参数，代价计算器按值持有并直接调用，聚合内循环可被内联展开
+ * \tparam CostCpt		代价计算器类型
+ * \tparam PatchSize	Patch尺寸，0表示由运行期参数PMSOption::_patchSize指定
+ * \tparam IsForceFpw	是否强制为Frontal-Parallel Window
+ * \tparam IsIntegerDisp	是否为整像素视差
+ */
+template<typename CostCpt, sint32 PatchSize, bool IsForceFpw, bool IsIntegerDisp>
+struct PMSPolicy {
+    typedef CostCpt CostComputerType;
+    static constexpr sint32 patchSize = PatchSize;
+    static constexpr bool isForceFpw = IsForceFpw;
+    static constexpr bool isIntegerDisp = IsIntegerDisp;
+
+    /** \brief 由视图输入构建代价计算器，各代价计算器只取自身所需的数据 */
+    static CostComputerType createCostComputer(const PMSOption &option, const PMSCostInput &input) {
+        return CostComputerType::create(option, input);
+    }
+};
 
+template<typename Policy>
 class PMSPropagation {
-
 public:
+    /** \brief 单像素传播步骤 */
+    enum class PixelStep {
+        SpatialPropagation,     // 空间传播
+        PlaneRefine             // 平面优化
+    };
+
+    /**
+     * \brief 构造传播实例，由策略构建左右视图的代价计算器，并计算初始代价数据
+     * \param option		本视图的算法参数
+     * \param inputLeft	本视图的代价计算器输入
+     * \param inputRight	另一视图的代价计算器输入，视差范围与本视图相反
+     */
     PMSPropagation(const PMSOption &option,
-                   const sint32 &width, const sint32 &height,
-                   const uint8 *imgLeft, const uint8 *imgRight,
-                   const PGradient *gradLeft, const PGradient *gradRight,
+                   const PMSCostInput &inputLeft, const PMSCostInput &inputRight,
                    DisparityPlane *planeLeft, DisparityPlane *planeRight,
                    float32 *costLeft, float32 *costRight,
                    float32 *disparityMap);
 
-    ~PMSPropagation();
+    ~PMSPropagation() = default;
 
     /** \brief 执行传播一次 */
     void doPropagation();
 
+    /**
+     * \brief 时序传播：以上一帧同位置及四邻域的平面作为候选，更新当前平面
+     * \param planePrev 上一帧的平面集
+     */
+    void doTemporalPropagation(const DisparityPlane *planePrev);
+
+    /** \brief 获取累计统计量（各线程汇总） */
+    PMSStatistics getStatistics() const;
+
+    /** \brief 获取最近一次传播中实际处理的像素比例，未启用活动集时为1 */
+    float32 getActiveRatio() const;
+
+    /**
+     * \brief 对单个像素执行一个传播步骤，供内核微基准测试逐像素计时；不改变迭代次数及活动集
+     * \param step 传播步骤
+     * \param x 像素x坐标
+     * \param y 像素y坐标
+     * \param direction 传播方向，只用于空间传播
+     * \param stats 统计量
+     */
+    void doPixelStep(const PixelStep &step, const sint32 &x, const sint32 &y, const sint32 &direction,
+                     PMSStatistics &stats);
+
 private:
+    typedef typename Policy::CostComputerType CostComputerType;
+    static constexpr sint32 PatchSize = Policy::patchSize;
+    static constexpr bool IsForceFpw = Policy::isForceFpw;
+    static constexpr bool IsIntegerDisp = Policy::isIntegerDisp;
+
     /** \brief PMS算法参数*/
     PMSOption _option;
 
@@ -55,40 +115,105 @@ private:
     float32 *_disparityMap;
 
     /** \brief 代价计算器 */
-    CostComputer *_costCptLeft;
-    CostComputer *_costCptRight;
+    CostComputerType _costCptLeft;
+    CostComputerType _costCptRight;
 
     /** \brief 传播迭代次数 */
     sint32 _numIter;
 
-    /** \brief 随机数生成器 */
-    std::uniform_real_distribution<float32>* _randDisp;
-    std::uniform_real_distribution<float32>* _randNorm;
+    /** \brief 各线程的统计量，按线程序号独立累加；并行循环内先累加到局部统计量，每行合并一次 */
+    std::vector<PMSStatistics> _threadStats;
+
+    /** \brief 活动集：上一轮开始时的平面快照，及自上一轮开始以来平面是否变化的标记 */
+    std::vector<DisparityPlane> _planeSnapshot;
+    std::vector<uint8> _dirty;
+
+    /** \brief 最近一次传播中实际处理的像素比例 */
+    float32 _activeRatio;
+
+    /** \brief 由平面快照更新变化标记，并保存本轮开始时的平面快照 */
+    void updateActiveSet();
+
+    /**
+     * \brief 判断平面是否发生变化：Patch范围内的最大视差变化超过阈值
+     * \param planeOld 原平面
+     * \param planeNew 新平面
+     * \param x 像素x坐标
+     * \param y 像素y坐标
+     */
+    bool isPlaneChanged(const DisparityPlane& planeOld, const DisparityPlane& planeNew,
+                        const sint32& x, const sint32& y) const;
+
+    /**
+     * \brief 判断像素是否需要处理：自身或传播邻域中有平面发生变化
+     * \param x 像素x坐标
+     * \param y 像素y坐标
+     */
+    bool isActive(const sint32& x, const sint32& y) const;
 
     /** \brief 计算代价数据 */
     void computeCostData();
 
+    /** \brief 顺序传播一次：偶数次迭代从左上到右下，奇数次迭代从右下到左上 */
+    void doSequentialPropagation();
+
+    /** \brief 红黑棋盘格并行传播一次：先并行更新红色像素，再并行更新黑色像素 */
+    void doCheckerboardPropagation();
+
     /**
      * \brief 空间传播
      * \param x 像素x坐标
      * \param y 像素y坐标
      * \param direction 传播方向
+     * \param stats 统计量
+     */
+    void spatialPropagation(const sint32& x, const sint32& y, const sint32& direction, PMSStatistics& stats);
+
+    /**
+     * \brief 棋盘格模式下的空间传播，候选平面取自四个方向上不同距离的异色邻域像素
+     * \param x 像素x坐标
+     * \param y 像素y坐标
+     * \param stats 统计量
      */
-    void spatialPropagation(const sint32& x, const sint32& y, const sint32& direction);
+    void checkerboardSpatialPropagation(const sint32& x, const sint32& y, PMSStatistics& stats);
 
     /**
      * \brief 视图传播
      * \param x 像素x坐标
      * \param y 像素y坐标
+     * \param stats 统计量
      */
-    void viewPropagation(const sint32& x, const sint32& y);
+    void viewPropagation(const sint32& x, const sint32& y, PMSStatistics& stats);
 
     /**
      * \brief 平面优化
      * \param x 像素x坐标
      * \param y 像素y坐标
+     * \param stats 统计量
+     */
+    void planeRefine(const sint32& x, const sint32& y, PMSStatistics& stats);
+
+    /**
+     * \brief 将平面加入候选集，与p当前平面或已有候选相同的平面不重复加入
+     * \param plane 待加入平面
+     * \param planeP p当前平面
+     * \param candidates 候选平面数组
+     * \param num 候选平面数量
+     */
+    static void addCandidate(const DisparityPlane& plane, const DisparityPlane& planeP,
+                             DisparityPlane* candidates, sint32& num);
+
+    /**
+     * \brief 批量计算候选平面的聚合代价，若有代价小于p当前代价者则更新p的平面和代价
+     * \param x 像素x坐标
+     * \param y 像素y坐标
+     * \param candidates 候选平面数组
+     * \param num 候选平面数量
+     * \param stats 统计量
+     * \return 被采纳的候选序号，无更新时返回-1
      */
-    void planeRefine(const sint32& x, const sint32& y);
+    sint32 selectBestPlane(const sint32& x, const sint32& y, const DisparityPlane* candidates, const sint32& num,
+                           PMSStatistics& stats);
 };
 
 
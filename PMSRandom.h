@@ -0,0 +1,61 @@
+//
+// Created by tianhe on 2022/9/3.
+//
+
+#ifndef PMSRANDOM_H
+#define PMSRANDOM_H
+
+#include "PMSType.h"
+
+/**
+ * \brief 基于计数器的随机数生成器
+ * 随机序列只由(种子, 键)决定，与线程划分、调用顺序无关；构造仅需几次整数运算，可逐像素创建
+ */
+class PMSRandom {
+public:
+    /**
+     * \brief 构造
+     * \param seed	随机种子
+     * \param key	序列键，一般由像素序号、迭代次数等组合得到
+     */
+    PMSRandom(const uint64 &seed, const uint64 &key) : _state(mix(seed ^ mix(key))), _counter(0) {}
+
+    /** \brief 生成下一个64位随机数 */
+    uint64 next() {
+        return mix(_state + (++_counter) * 0x9E3779B97F4A7C15ull);
+    }
+
+    /**
+     * \brief 生成 [lo, hi) 区间内均匀分布的随机浮点数
+     * \param lo	下界
+     * \param hi	上界
+     */
+    float32 uniform(const float32 &lo, const float32 &hi) {
+        const float32 u = float32(next() >> 40) * (1.0f / 16777216.0f);
+        return lo + (hi - lo) * u;
+    }
+
+    /**
+     * \brief 组合两个32位值为序列键
+     * \param hi	高32位
+     * \param lo	低32位
+     */
+    static uint64 makeKey(const uint32 &hi, const uint32 &lo) {
+        return (uint64(hi) << 32) | uint64(lo);
+    }
+
+    /** \brief splitmix64 混合函数 */
+    static uint64 mix(uint64 z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+private:
+    /** \brief 序列初始状态 */
+    uint64 _state;
+    /** \brief 计数器 */
+    uint64 _counter;
+};
+
+#endif //PMSRANDOM_H
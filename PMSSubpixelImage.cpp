@@ -0,0 +1,92 @@
+//
+// Created by tianhe on 2022/9/23.
+//
+
+#include "PMSSubpixelImage.h"
+
+#include "PMSParallel.h"
+
+static_assert(sizeof(PMSSubpixelFeature) == 16, "subpixel feature must be 16 bytes");
+
+PMSSubpixelImage::PMSSubpixelImage() : _width(0), _height(0), _step(0), _rowSize(0), _features(nullptr),
+                                       _isBuilt(false) {
+
+}
+
+uint64 PMSSubpixelImage::getMemoryBytes(const sint32 &width, const sint32 &height, const sint32 &step) {
+    if (width <= 0 || height <= 0 || !isValidStep(step)) {
+        return 0;
+    }
+    return PMSArena::alignUp((uint64(width) * uint64(step) + 1) * uint64(height) * sizeof(PMSSubpixelFeature));
+}
+
+bool PMSSubpixelImage::allocate(PMSArena &arena, const sint32 &width, const sint32 &height, const sint32 &step) {
+    release();
+    if (width <= 0 || height <= 0 || !isValidStep(step)) {
+        return false;
+    }
+    _width = width;
+    _height = height;
+    _step = step;
+    _rowSize = width * step + 1;
+    _features = arena.allocate<PMSSubpixelFeature>(uint64(_rowSize) * uint64(height));
+    if (_features == nullptr) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+void PMSSubpixelImage::release() {
+    clear();
+    _width = _height = 0;
+    _step = 0;
+    _rowSize = 0;
+    _features = nullptr;
+}
+
+bool PMSSubpixelImage::build(const uint8 *img, const PGradient *grad, const sint32 &numThreads) {
+    clear();
+    if (_features == nullptr || img == nullptr || grad == nullptr) {
+        return false;
+    }
+
+    const sint32 width = _width;
+    const sint32 height = _height;
+    const sint32 step = _step;
+
+    // 第k个细分位置的插值系数为k/step，乘以比例因子后为整数 k*unit
+    const sint32 unit = FIXED_SCALE / step;
+    parallelFor(0, height, numThreads, [&](const sint32 &y, const sint32 &) {
+        const uint8 *row = img + size_t(y) * width * 3;
+        const PGradient *gradRow = grad + size_t(y) * width;
+        PMSSubpixelFeature *dst = _features + size_t(y) * _rowSize;
+        for (sint32 x = 0; x < width; x++) {
+            // 最后一个像素右侧与其自身插值，与逐点插值的边界处理一致
+            const sint32 x2 = (x + 1 < width) ? x + 1 : x;
+            const uint8 *col1 = row + x * 3;
+            const uint8 *col2 = row + x2 * 3;
+            const PGradient &grad1 = gradRow[x];
+            const PGradient &grad2 = gradRow[x2];
+            for (sint32 k = 0; k < step; k++) {
+                const sint32 w2 = k * unit;
+                const sint32 w1 = FIXED_SCALE - w2;
+                auto &f = dst[x * step + k];
+                f._b = sint16(w1 * col1[0] + w2 * col2[0]);
+                f._g = sint16(w1 * col1[1] + w2 * col2[1]);
+                f._r = sint16(w1 * col1[2] + w2 * col2[2]);
+                f._gx = sint16(w1 * grad1._x + w2 * grad2._x);
+                f._gy = sint16(w1 * grad1._y + w2 * grad2._y);
+                f._reserved[0] = f._reserved[1] = f._reserved[2] = 0;
+            }
+        }
+        dst[width * step] = dst[(width - 1) * step];
+    });
+
+    _isBuilt = true;
+    return true;
+}
+
+void PMSSubpixelImage::clear() {
+    _isBuilt = false;
+}
@@ -0,0 +1,114 @@
+//
+// Created by tianhe on 2022/9/23.
+//
+
+#ifndef PMSSUBPIXELIMAGE_H
+#define PMSSUBPIXELIMAGE_H
+
+#include "PMSType.h"
+#include "PMSArena.h"
+
+/**
+ * \brief 亚像素特征：颜色及梯度，均为定点数，16字节对齐
+ */
+struct alignas(16) PMSSubpixelFeature {
+    sint16 _b, _g, _r;      // 颜色
+    sint16 _gx, _gy;        // 梯度
+    sint16 _reserved[3];    // 保留，置0
+};
+
+/**
+ * \brief 水平方向亚像素预插值的影像特征
+ * 代价计算时同名点的x坐标为浮点数，逐点双线性插值颜色和梯度需要两次取数及边界判断。
+ * 预先按细分数在每两个像素之间插入等间隔的亚像素特征，同名点取最近的亚像素位置，采样只需一次对齐读取。
+ * 细分数为16的约数，特征以4位小数的定点数存储，插值结果可精确表示；
+ * 与逐点插值相比，亚像素位置误差不超过半个细分间隔，内存占用为每像素 细分数x16 字节，由内存池分配
+ */
+class PMSSubpixelImage {
+public:
+    /** \brief 定点数的小数位数 */
+    static constexpr sint32 FRACTION_BITS = 4;
+    /** \brief 定点数的比例因子 */
+    static constexpr sint32 FIXED_SCALE = 1 << FRACTION_BITS;
+
+    PMSSubpixelImage();
+
+    ~PMSSubpixelImage() = default;
+
+    /** \brief 细分数是否有效：须为16的约数 */
+    static bool isValidStep(const sint32 &step) {
+        return step > 0 && step <= FIXED_SCALE && FIXED_SCALE % step == 0;
+    }
+
+    /** \brief 亚像素特征占用的内存池字节数 */
+    static uint64 getMemoryBytes(const sint32 &width, const sint32 &height, const sint32 &step);
+
+    /**
+     * \brief 从内存池分配特征数据
+     * \param arena		内存池
+     * \param width		影像宽
+     * \param height	影像高
+     * \param step		细分数，须为16的约数
+     * \return 是否分配成功
+     */
+    bool allocate(PMSArena &arena, const sint32 &width, const sint32 &height, const sint32 &step);
+
+    /** \brief 解除与内存池的关联 */
+    void release();
+
+    /**
+     * \brief 构建亚像素特征
+     * \param img			影像数据，3通道
+     * \param grad			梯度数据
+     * \param numThreads	构建线程数
+     * \return 是否构建成功
+     */
+    bool build(const uint8 *img, const PGradient *grad, const sint32 &numThreads);
+
+    /** \brief 清空构建状态，内存仍保留在内存池中 */
+    void clear();
+
+    /** \brief 是否已构建 */
+    bool isValid() const {
+        return _isBuilt;
+    }
+
+    /** \brief 细分数 */
+    sint32 getStep() const {
+        return _step;
+    }
+
+    /** \brief 每行的特征数 */
+    sint32 getRowSize() const {
+        return _rowSize;
+    }
+
+    /** \brief 特征数据 */
+    const PMSSubpixelFeature *getData() const {
+        return _features;
+    }
+
+    /** \brief 坐标(x,y)处最近的亚像素特征，调用前需保证 0<=x<width */
+    const PMSSubpixelFeature &sample(const float32 &x, const sint32 &y) const {
+        return _features[size_t(y) * _rowSize + sint32(x * float32(_step) + 0.5f)];
+    }
+
+private:
+    /** \brief 影像宽高 */
+    sint32 _width;
+    sint32 _height;
+
+    /** \brief 细分数 */
+    sint32 _step;
+
+    /** \brief 每行的特征数：width*step，末尾再多存一个特征供最后一个像素右侧半个间隔内的坐标取整 */
+    sint32 _rowSize;
+
+    /** \brief 特征数据 */
+    PMSSubpixelFeature *_features;
+
+    /** \brief 是否已构建 */
+    bool _isBuilt;
+};
+
+#endif //PMSSUBPIXELIMAGE_H
@@ -0,0 +1,150 @@
+//
+// Created by tianhe on 2022/9/21.
+//
+
+#include "PMSTiled.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "PMSParallel.h"
+#include "PMSRandom.h"
+
+PMSTiledMatcher::PMSTiledMatcher(const PMSOption &option, const sint32 &tileSize, const sint32 &numEngines) {
+    _tileSize = std::max(tileSize, 1);
+    _buffers.resize(resolveThreadCount(numEngines));
+    for (auto &buffer: _buffers) {
+        buffer._engine.reset(new PatchMatchStereo());
+    }
+    reset(option);
+}
+
+bool PMSTiledMatcher::reset(const PMSOption &option) {
+    _option = option;
+    _statistics = PMSStatistics();
+    // 各实例并行处理不同分块，未指定线程数时平分硬件线程，避免线程超额
+    if (_option._numThreads <= 0) {
+        _option._numThreads = std::max(1, resolveThreadCount(0) / sint32(_buffers.size()));
+    }
+
+    // 按最大分块预分配，之后各分块复用；晕圈随视差范围变化，内存池容量足够时不重新分配
+    const sint32 cropWidth = _tileSize + 2 * getHaloX();
+    const sint32 cropHeight = _tileSize + 2 * getHaloY();
+    bool isSuccess = true;
+    for (auto &buffer: _buffers) {
+        isSuccess = buffer._engine->reset(uint32(cropWidth), uint32(cropHeight), _option) && isSuccess;
+        buffer._imgLeft.reserve(size_t(cropWidth) * cropHeight * 3);
+        buffer._imgRight.reserve(size_t(cropWidth) * cropHeight * 3);
+    }
+    return isSuccess;
+}
+
+sint32 PMSTiledMatcher::getHaloX() const {
+    // 左视图像素x的同名点为x-d，右视图像素x的同名点为x+d，两侧都需覆盖视差范围
+    const sint32 range = std::max(0, std::max(_option._maxDisparity, -_option._minDisparity));
+    return _option._patchSize / 2 + PROPAGATION_MARGIN + range;
+}
+
+sint32 PMSTiledMatcher::getHaloY() const {
+    return _option._patchSize / 2 + PROPAGATION_MARGIN;
+}
+
+sint32 PMSTiledMatcher::getNumEngines() const {
+    return sint32(_buffers.size());
+}
+
+uint64 PMSTiledMatcher::getMemoryFootprint() const {
+    const sint32 cropWidth = _tileSize + 2 * getHaloX();
+    const sint32 cropHeight = _tileSize + 2 * getHaloY();
+    const uint64 perEngine = PatchMatchStereo::getMemoryFootprint(cropWidth, cropHeight, _option) +
+                             2 * uint64(cropWidth) * uint64(cropHeight) * 3;
+    return perEngine * _buffers.size();
+}
+
+const PMSStatistics &PMSTiledMatcher::getStatistics() const {
+    return _statistics;
+}
+
+std::vector<PMSTile> PMSTiledMatcher::makeTiles(const sint32 &width, const sint32 &height) const {
+    std::vector<PMSTile> tiles;
+    const sint32 haloX = getHaloX();
+    const sint32 haloY = getHaloY();
+    for (sint32 y = 0; y < height; y += _tileSize) {
+        for (sint32 x = 0; x < width; x += _tileSize) {
+            PMSTile tile{};
+            tile._x = x;
+            tile._y = y;
+            tile._width = std::min(_tileSize, width - x);
+            tile._height = std::min(_tileSize, height - y);
+            // 裁剪区在影像边界处截断
+            tile._cropX = std::max(0, x - haloX);
+            tile._cropY = std::max(0, y - haloY);
+            tile._cropWidth = std::min(width, x + tile._width + haloX) - tile._cropX;
+            tile._cropHeight = std::min(height, y + tile._height + haloY) - tile._cropY;
+            tiles.push_back(tile);
+        }
+    }
+    return tiles;
+}
+
+bool PMSTiledMatcher::match(const uint8 *imgLeft, const uint8 *imgRight, const sint32 &width, const sint32 &height,
+                            float32 *dispLeft, float32 *dispRight) {
+    _statistics = PMSStatistics();
+    if (imgLeft == nullptr || imgRight == nullptr || dispLeft == nullptr || width <= 0 || height <= 0) {
+        return false;
+    }
+
+    const auto tiles = makeTiles(width, height);
+    std::atomic<bool> isSuccess(true);
+    for (auto &buffer: _buffers) {
+        buffer._statistics = PMSStatistics();
+    }
+
+    parallelFor(0, sint32(tiles.size()), sint32(_buffers.size()), [&](const sint32 &i, const sint32 &tid) {
+        const auto &tile = tiles[i];
+        auto &buffer = _buffers[tid];
+        auto &engine = *buffer._engine;
+
+        // 裁剪左右影像，映射文件只有这些行会被访问
+        const size_t rowBytes = size_t(tile._cropWidth) * 3;
+        buffer._imgLeft.resize(rowBytes * tile._cropHeight);
+        buffer._imgRight.resize(rowBytes * tile._cropHeight);
+        for (sint32 y = 0; y < tile._cropHeight; y++) {
+            const size_t offset = (size_t(tile._cropY + y) * width + tile._cropX) * 3;
+            memcpy(buffer._imgLeft.data() + y * rowBytes, imgLeft + offset, rowBytes);
+            memcpy(buffer._imgRight.data() + y * rowBytes, imgRight + offset, rowBytes);
+        }
+
+        // 各分块的随机种子只取决于分块位置，结果与实例数无关
+        PMSOption option = _option;
+        option._seed = PMSRandom::mix(_option._seed ^ PMSRandom::makeKey(uint32(tile._y), uint32(tile._x)));
+        if (!engine.reset(uint32(tile._cropWidth), uint32(tile._cropHeight), option) ||
+            !engine.match(buffer._imgLeft.data(), buffer._imgRight.data(), nullptr, nullptr)) {
+            isSuccess = false;
+            return;
+        }
+        buffer._statistics += engine.getStatistics();
+
+        // 只写回核心区
+        const sint32 offsetX = tile._x - tile._cropX;
+        const sint32 offsetY = tile._y - tile._cropY;
+        for (sint32 view = 0; view < 2; view++) {
+            float32 *disp = (view == 0) ? dispLeft : dispRight;
+            const float32 *dispTile = engine.getDisparityMap(view);
+            if (disp == nullptr || dispTile == nullptr) {
+                continue;
+            }
+            for (sint32 y = 0; y < tile._height; y++) {
+                memcpy(disp + size_t(tile._y + y) * width + tile._x,
+                       dispTile + size_t(offsetY + y) * tile._cropWidth + offsetX,
+                       size_t(tile._width) * sizeof(float32));
+            }
+        }
+    });
+
+    for (const auto &buffer: _buffers) {
+        _statistics += buffer._statistics;
+    }
+    return isSuccess;
+}
@@ -0,0 +1,106 @@
+//
+// Created by tianhe on 2022/9/21.
+//
+
+#ifndef PMSTILED_H
+#define PMSTILED_H
+
+#include <memory>
+#include <vector>
+
+#include "PMSType.h"
+#include "PatchMatchStereo.h"
+
+/**
+ * \brief 分块：核心区（输出区域）及含晕圈的裁剪区，坐标均为整幅影像坐标
+ */
+struct PMSTile {
+    sint32 _x, _y;                      // 核心区左上角
+    sint32 _width, _height;             // 核心区尺寸
+    sint32 _cropX, _cropY;              // 裁剪区左上角
+    sint32 _cropWidth, _cropHeight;     // 裁剪区尺寸
+};
+
+/**
+ * \brief 分块匹配器：超大影像按重叠分块匹配，内存占用只与分块尺寸及实例数有关
+ * 每个分块在左右影像上裁剪相同的区域：核心区向四周扩展半个Patch及传播余量，水平方向再扩展视差范围，
+ * 使核心区像素在左右视图中的所有候选同名点及其Patch都落在裁剪区内。
+ * 各分块动态分配给固定数量的匹配实例并行处理，只将核心区结果写回整幅视差图，晕圈部分丢弃，
+ * 因此分块接缝处的像素与非接缝处具有相同的上下文。输入影像可以是内存映射的文件，只有被裁剪的行会调入内存
+ */
+class PMSTiledMatcher {
+public:
+    /** \brief 晕圈中除半个Patch外额外保留的传播余量（像素） */
+    static constexpr sint32 PROPAGATION_MARGIN = 16;
+
+    /**
+     * \brief 构造
+     * \param option		匹配参数
+     * \param tileSize		分块核心区边长
+     * \param numEngines	匹配实例（工作线程）数，<=0 时取硬件并发线程数
+     */
+    explicit PMSTiledMatcher(const PMSOption &option, const sint32 &tileSize = 512, const sint32 &numEngines = 0);
+
+    ~PMSTiledMatcher() = default;
+
+    /**
+     * \brief 重设匹配参数（如换用另一像对的视差范围），实例及分块缓冲区复用，容量足够时不重新分配
+     * \param option 匹配参数
+     * \return 是否重设成功
+     */
+    bool reset(const PMSOption &option);
+
+    /**
+     * \brief 分块匹配
+     * \param imgLeft	输入，左影像数据指针，3通道
+     * \param imgRight	输入，右影像数据指针，3通道
+     * \param width		输入，影像宽
+     * \param height	输入，影像高
+     * \param dispLeft	输出，左影像视差图指针，预先分配和影像等尺寸的内存空间
+     * \param dispRight	输出，右影像视差图指针，预先分配和影像等尺寸的内存空间；只计算左视图时不输出
+     * \return 是否所有分块都匹配成功
+     */
+    bool match(const uint8 *imgLeft, const uint8 *imgRight, const sint32 &width, const sint32 &height,
+               float32 *dispLeft, float32 *dispRight);
+
+    /** \brief 将影像划分为分块 */
+    std::vector<PMSTile> makeTiles(const sint32 &width, const sint32 &height) const;
+
+    /** \brief 水平方向晕圈宽度 */
+    sint32 getHaloX() const;
+
+    /** \brief 竖直方向晕圈宽度 */
+    sint32 getHaloY() const;
+
+    /** \brief 匹配实例数 */
+    sint32 getNumEngines() const;
+
+    /** \brief 所有实例的工作内存上限（字节），与影像尺寸无关 */
+    uint64 getMemoryFootprint() const;
+
+    /** \brief 获取最近一次匹配各分块累计的传播统计量 */
+    const PMSStatistics &getStatistics() const;
+
+private:
+    /** \brief 每个匹配实例独占的分块缓冲区 */
+    struct TileBuffer {
+        std::unique_ptr<PatchMatchStereo> _engine;      // 匹配实例
+        std::vector<uint8> _imgLeft;                    // 左影像裁剪区
+        std::vector<uint8> _imgRight;                   // 右影像裁剪区
+        PMSStatistics _statistics;                      // 统计量
+    };
+
+    /** \brief 匹配参数 */
+    PMSOption _option;
+
+    /** \brief 分块核心区边长 */
+    sint32 _tileSize;
+
+    /** \brief 分块缓冲区，按工作线程序号使用 */
+    std::vector<TileBuffer> _buffers;
+
+    /** \brief 统计量 */
+    PMSStatistics _statistics;
+};
+
+#endif //PMSTILED_H
@@ -27,6 +27,12 @@ typedef uint64_t uint64;    // 无符号64位整数
 typedef float float32;      // 单精度浮点
 typedef double float64;     // 双精度浮点
 
+/** \brief 代价计算器类型 */
+enum PMSCostType : sint32 {
+    PMS_COST_PMS = 0,       // 原文代价：颜色与梯度的截断绝对差，亚像素位置双线性插值
+    PMS_COST_CENSUS = 1     // Census变换代价：汉明距离，纹理丰富时速度快、精度略低
+};
+
 /** \brief PMS参数结构体 */
 struct PMSOption {
     sint32 _patchSize;              // patch尺寸，局部窗口为 patch_size*patch_size
@@ -37,9 +43,11 @@ struct PMSOption {
     float32 _alpha;                 // alpha 相似度平衡因子
     float32 _tauCol;                // tau for color	相似度计算颜色空间的绝对差的下截断阈值
     float32 _tauGrad;               // tau for gradient 相似度计算梯度空间的绝对差下截断阈值
+    PMSCostType _costType;          // 代价计算器类型
 
     sint32 _numIters;               // 传播迭代次数
 
+    bool _isLeftOnly;               // 是否只计算左视图：不传播右视图、不分配右视图的代价/视差/平面内存，此时不做一致性检查
     bool _isCheckLR;                // 是否检查左右一致性
     float32 _lrCheckThres;          // 左右一致性约束阈值
 
@@ -47,10 +55,96 @@ struct PMSOption {
 
     bool _isForceFpw;               // 是否强制为Frontal-Parallel Window
     bool _isIntegerDisp;            // 是否为整像素视差
+    bool _isUseCostVolume;          // 强制Frontal-Parallel且为整像素视差时，是否预先聚合全部整数视差的代价，传播中查表
+
+    sint32 _numPyramidLevels;       // 金字塔层数，1表示不使用；每层分辨率减半，由粗到精传递平面作为初值
+    sint32 _numCoarseIters;         // 金字塔粗层的传播迭代次数
+
+    bool _isCheckerboard;           // 是否采用红黑棋盘格并行传播
+    sint32 _numThreads;             // 并行线程数，<=0 时取硬件并发线程数
+
+    bool _isUseSimd;                // 是否使用SIMD聚合核(CPU支持AVX2时生效)，否则使用标量实现
+    bool _isKeepGray;               // 是否保留左右影像的灰度图(getGrayMap)；默认不保留，灰度在梯度计算中逐行生成后即丢弃
+
+    uint64 _seed;                   // 随机种子，输入与种子相同时结果逐位一致
+
+    bool _isUseWeightCache;         // 是否预先缓存各像素的支持权值(8位量化)，迭代中复用
+    float32 _weightCacheThres;      // 权值缓存阈值，低于该值的权值被舍弃
+
+    sint32 _subpixelStep;           // 右影像水平亚像素预插值的细分数(4、8或16)，同名点取最近的亚像素位置，
+                                    // 每像素占用 细分数x16 字节；0表示逐点双线性插值（精确）
+
+    bool _isUseActiveSet;           // 是否只处理活动像素：自身或邻域平面在上一轮及本轮迭代中发生变化的像素
+    float32 _activeSetThres;        // 活动像素比例低于该值时提前结束迭代，0表示始终迭代_numIters次
+
+    float32 _temporalRandomRatio;   // 视频模式：每帧重新随机初始化的像素比例，其余像素沿用上一帧平面
+    sint32 _numTemporalIters;       // 视频模式：非首帧的传播迭代次数
 
     PMSOption() : _patchSize(35), _minDisparity(0), _maxDisparity(64), _gamma(10.0f), _alpha(0.9f),
-                  _tauCol(10.0f), _tauGrad(2.0f), _numIters(3), _isCheckLR(false), _lrCheckThres(0),
-                  _isFillHoles(false), _isForceFpw(false), _isIntegerDisp(false) {}
+                  _tauCol(10.0f), _tauGrad(2.0f), _costType(PMS_COST_PMS),
+                  _numIters(3), _isLeftOnly(false), _isCheckLR(false), _lrCheckThres(0),
+                  _isFillHoles(false), _isForceFpw(false), _isIntegerDisp(false), _isUseCostVolume(false),
+                  _numPyramidLevels(1), _numCoarseIters(3),
+                  _isCheckerboard(false), _numThreads(0), _isUseSimd(true), _isKeepGray(false),
+                  _seed(0), _isUseWeightCache(false), _weightCacheThres(0.01f), _subpixelStep(0),
+                  _isUseActiveSet(false), _activeSetThres(0.0f),
+                  _temporalRandomRatio(0.1f), _numTemporalIters(1) {}
+};
+
+/**
+ * \brief 传播统计量
+ */
+struct PMSStatistics {
+    uint64 _numEvaluations;         // 候选平面聚合代价计算次数
+    uint64 _numPruned;              // 因超过代价上界被提前终止或直接剔除的计算次数
+    uint64 _numProcessed;           // 传播中实际处理的像素次数（启用活动集时跳过已收敛像素）
+    uint64 _numSpatialAccepted;     // 空间传播更新了平面的次数
+    uint64 _numSpatialRejected;     // 空间传播计算了候选但未更新平面的次数
+    uint64 _numRefineAccepted;      // 平面优化更新了平面的次数
+    uint64 _numRefineRejected;      // 平面优化计算了候选但未更新平面的次数
+    uint64 _numRefineOutOfRange;    // 平面优化中视差超出范围而被舍弃的随机候选数
+    uint64 _numViewAccepted;        // 视图传播更新了另一视图平面的次数
+    uint64 _numViewRejected;        // 视图传播计算了候选但未更新平面的次数
+    uint64 _numLRMismatches;        // 一致性检查剔除的像素数（含无效视差），左右视图之和
+
+    PMSStatistics() : _numEvaluations(0), _numPruned(0), _numProcessed(0),
+                      _numSpatialAccepted(0), _numSpatialRejected(0),
+                      _numRefineAccepted(0), _numRefineRejected(0), _numRefineOutOfRange(0),
+                      _numViewAccepted(0), _numViewRejected(0), _numLRMismatches(0) {}
+
+    PMSStatistics &operator+=(const PMSStatistics &s) {
+        _numEvaluations += s._numEvaluations;
+        _numPruned += s._numPruned;
+        _numProcessed += s._numProcessed;
+        _numSpatialAccepted += s._numSpatialAccepted;
+        _numSpatialRejected += s._numSpatialRejected;
+        _numRefineAccepted += s._numRefineAccepted;
+        _numRefineRejected += s._numRefineRejected;
+        _numRefineOutOfRange += s._numRefineOutOfRange;
+        _numViewAccepted += s._numViewAccepted;
+        _numViewRejected += s._numViewRejected;
+        _numLRMismatches += s._numLRMismatches;
+        return *this;
+    }
+};
+
+/**
+ * \brief 匹配各阶段耗时（毫秒）
+ */
+struct PMSTimings {
+    float64 _initialization;        // 随机初始化（视频模式下为时序初始化）
+    float64 _computeGradient;       // 计算灰度及梯度图
+    float64 _computeFeatures;       // 构建分平面特征
+    float64 _pyramid;               // 金字塔初始化
+    float64 _propagation;           // 迭代传播（含代价初始化）
+    float64 _planeToDisparity;      // 平面转换成视差
+    float64 _lrCheck;               // 左右一致性检查
+    float64 _fillHoles;             // 视差填充
+    float64 _total;                 // 总耗时
+    std::vector<float64> _iterations;   // 各次传播迭代耗时（左右视图之和）
+
+    PMSTimings() : _initialization(0), _computeGradient(0), _computeFeatures(0), _pyramid(0), _propagation(0),
+                   _planeToDisparity(0), _lrCheck(0), _fillHoles(0), _total(0) {}
 };
 
 /**
@@ -260,6 +354,16 @@ struct DisparityPlane {
         return {-_p._x, -_p._y, -_p._z - _p._x * d};
     }
 
+    /**
+     * \brief 将2倍降采样影像坐标系下的平面转换到原影像坐标系
+     * 降采样像素(x',y')覆盖原影像2x2像素，中心对应原坐标 x = 2x'+0.5，y = 2y'+0.5，且视差放大2倍
+     * 代入 d = 2(a_p*x' + b_p*y' + c_p) 得 d = a_p*x + b_p*y + 2c_p - (a_p+b_p)/2
+     * \return 转换后的平面
+     */
+    DisparityPlane toFinerLevel() const {
+        return {_p._x, _p._y, 2.0f * _p._z - 0.5f * (_p._x + _p._y)};
+    }
+
     // operator ==
     bool operator==(const DisparityPlane &v) const {
         return _p == v._p;
@@ -0,0 +1,108 @@
+//
+// Created by tianhe on 2022/9/10.
+//
+
+#include "PMSWeightCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "PMSParallel.h"
+
+/** \brief 缓存末尾的补齐字节数，供一次读取8个权值的向量实现使用 */
+static const uint64 TAIL_PADDING = 8;
+
+PMSWeightCache::PMSWeightCache() : _x0(0), _y0(0), _x1(0), _y1(0), _patchSize(0), _windowSize(0),
+                                   _capacity(0), _weights(nullptr) {
+
+}
+
+uint64 PMSWeightCache::getMemoryBytes(const sint32 &width, const sint32 &height, const sint32 &patchSize) {
+    if (width <= 0 || height <= 0 || patchSize <= 0) {
+        return 0;
+    }
+    return PMSArena::alignUp(uint64(width) * uint64(height) * uint64(patchSize) * uint64(patchSize) + TAIL_PADDING);
+}
+
+bool PMSWeightCache::allocate(PMSArena &arena, const sint32 &width, const sint32 &height, const sint32 &patchSize) {
+    release();
+    if (width <= 0 || height <= 0 || patchSize <= 0) {
+        return false;
+    }
+    _patchSize = patchSize;
+    _windowSize = uint64(patchSize) * uint64(patchSize);
+    _capacity = uint64(width) * uint64(height);
+    _weights = arena.allocate<uint8>(_capacity * _windowSize + TAIL_PADDING);
+    if (_weights == nullptr) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+void PMSWeightCache::release() {
+    clear();
+    _patchSize = 0;
+    _windowSize = 0;
+    _capacity = 0;
+    _weights = nullptr;
+}
+
+bool PMSWeightCache::build(const uint8 *img, const sint32 &width, const sint32 &height,
+                           const sint32 &patchSize, const float32 &gamma, const float32 &threshold,
+                           const sint32 &x0, const sint32 &y0, const sint32 &x1, const sint32 &y1,
+                           const sint32 &numThreads) {
+    clear();
+    if (_weights == nullptr || img == nullptr || width <= 0 || height <= 0 || patchSize != _patchSize ||
+        x0 < 0 || y0 < 0 || x1 > width || y1 > height || x0 >= x1 || y0 >= y1 ||
+        uint64(x1 - x0) * uint64(y1 - y0) > _capacity) {
+        return false;
+    }
+
+    _x0 = x0;
+    _y0 = y0;
+    _x1 = x1;
+    _y1 = y1;
+
+    const sint32 patHalf = patchSize / 2;
+    const sint32 regionWidth = x1 - x0;
+    const sint32 regionHeight = y1 - y0;
+
+    // 颜色差到量化权值的查找表，低于阈值的权值量化为0，表示舍弃
+    uint8 lut[3 * 255 + 1];
+    for (sint32 dc = 0; dc <= 3 * 255; dc++) {
+        const float32 w = std::exp(float32(-dc) / gamma);
+        lut[dc] = (w < threshold) ? uint8(0) : uint8(std::lround(w * 255.0f));
+    }
+
+    parallelFor(0, regionHeight, numThreads, [&](const sint32 &r, const sint32 &) {
+        const sint32 y = y0 + r;
+        const sint32 yBegin = std::max(y - patHalf, 0);
+        const sint32 yEnd = std::min(y + patHalf, height - 1);
+        for (sint32 c = 0; c < regionWidth; c++) {
+            const sint32 x = x0 + c;
+            const sint32 xBegin = std::max(x - patHalf, 0);
+            const sint32 xEnd = std::min(x + patHalf, width - 1);
+            const uint8 *colP = img + y * (width * 3) + x * 3;
+            // 影像外的像素权值为0
+            uint8 *window = _weights + (uint64(r) * uint64(regionWidth) + uint64(c)) * _windowSize;
+            memset(window, 0, _windowSize);
+            for (sint32 yq = yBegin; yq <= yEnd; yq++) {
+                uint8 *row = window + (yq - y + patHalf) * patchSize;
+                for (sint32 xq = xBegin; xq <= xEnd; xq++) {
+                    const uint8 *colQ = img + yq * (width * 3) + xq * 3;
+                    const sint32 dc = std::abs(colP[0] - colQ[0]) + std::abs(colP[1] - colQ[1]) +
+                                      std::abs(colP[2] - colQ[2]);
+                    row[xq - x + patHalf] = lut[dc];
+                }
+            }
+        }
+    });
+
+    return true;
+}
+
+void PMSWeightCache::clear() {
+    _x0 = _y0 = _x1 = _y1 = 0;
+}
@@ -0,0 +1,103 @@
+//
+// Created by tianhe on 2022/9/10.
+//
+
+#ifndef PMSWEIGHTCACHE_H
+#define PMSWEIGHTCACHE_H
+
+#include "PMSType.h"
+#include "PMSArena.h"
+
+/**
+ * \brief 支持权值缓存
+ * 支持窗口的权值 w = exp(-dc/gamma) 只由影像本身决定，各次迭代中同一像素的权值完全相同。
+ * 缓存按像素存储整个窗口的8位量化权值（patchSize x patchSize字节，按行排列），低于阈值的像素及
+ * 影像外的像素权值为0，表示舍弃；像素在窗口内的位置即为其偏移，无需另存。
+ * 缓存可只覆盖影像的一个矩形区域（如分块处理时的一个分块），以限制内存占用。内存由内存池分配
+ */
+class PMSWeightCache {
+public:
+    PMSWeightCache();
+
+    ~PMSWeightCache() = default;
+
+    /** \brief 缓存width x height个像素占用的内存池字节数 */
+    static uint64 getMemoryBytes(const sint32 &width, const sint32 &height, const sint32 &patchSize);
+
+    /**
+     * \brief 从内存池分配缓存数据
+     * \param arena		内存池
+     * \param width		可缓存区域的最大宽度
+     * \param height	可缓存区域的最大高度
+     * \param patchSize	局部Patch大小
+     * \return 是否分配成功
+     */
+    bool allocate(PMSArena &arena, const sint32 &width, const sint32 &height, const sint32 &patchSize);
+
+    /** \brief 解除与内存池的关联 */
+    void release();
+
+    /**
+     * \brief 构建缓存
+     * \param img			影像数据，3通道
+     * \param width			影像宽
+     * \param height		影像高
+     * \param patchSize		局部Patch大小，须与分配时一致
+     * \param gamma			参数gamma值
+     * \param threshold		权值阈值，低于该值的像素权值存为0
+     * \param x0			缓存区域左上角x坐标
+     * \param y0			缓存区域左上角y坐标
+     * \param x1			缓存区域右下角x坐标（不含）
+     * \param y1			缓存区域右下角y坐标（不含），区域像素数不超过分配时的容量
+     * \param numThreads	构建线程数
+     * \return 是否构建成功
+     */
+    bool build(const uint8 *img, const sint32 &width, const sint32 &height,
+               const sint32 &patchSize, const float32 &gamma, const float32 &threshold,
+               const sint32 &x0, const sint32 &y0, const sint32 &x1, const sint32 &y1,
+               const sint32 &numThreads);
+
+    /** \brief 清空缓存区域，内存仍保留在内存池中 */
+    void clear();
+
+    /** \brief 像素(x,y)是否在缓存区域内 */
+    bool contains(const sint32 &x, const sint32 &y) const {
+        return x >= _x0 && x < _x1 && y >= _y0 && y < _y1;
+    }
+
+    /** \brief 局部Patch大小，即窗口权值的行宽 */
+    sint32 getPatchSize() const {
+        return _patchSize;
+    }
+
+    /**
+     * \brief 像素(x,y)的窗口权值，调用前需保证像素在缓存区域内
+     * 偏移(dx,dy)处的权值位于 [(dy + patchSize/2) * patchSize + dx + patchSize/2]；
+     * 缓存末尾另有8字节补齐，窗口内任意位置起连续读取8字节均不越界
+     */
+    const uint8 *getWindow(const sint32 &x, const sint32 &y) const {
+        return _weights + (uint64(y - _y0) * uint64(_x1 - _x0) + uint64(x - _x0)) * _windowSize;
+    }
+
+    /** \brief 将量化权值还原为浮点权值 */
+    static float32 dequantize(const uint8 &w) {
+        return float32(w) * (1.0f / 255.0f);
+    }
+
+private:
+    /** \brief 缓存区域 [x0,x1) x [y0,y1) */
+    sint32 _x0, _y0, _x1, _y1;
+
+    /** \brief 局部Patch大小 */
+    sint32 _patchSize;
+    /** \brief 单个像素的窗口权值字节数 */
+    uint64 _windowSize;
+
+    /** \brief 可缓存的像素数 */
+    uint64 _capacity;
+
+    /** \brief 各像素的窗口权值，依次存放 */
+    uint8 *_weights;
+};
+
+#endif //PMSWEIGHTCACHE_H
@@ -4,14 +4,37 @@
 
 #include "PatchMatchStereo.h"
 
-#define SAFE_DELETE(P) if(P!=nullptr){delete[](P); (P)=nullptr;}
+#include <bitset>
+#include <chrono>
+#include <cstring>
+
+#include "PMSPreprocess.h"
+
+/**
+ * \brief 返回自start以来经过的毫秒数，并将start更新为当前时刻
+ */
+static float64 elapsedMs(std::chrono::steady_clock::time_point &start) {
+    const auto now = std::chrono::steady_clock::now();
+    const float64 ms = std::chrono::duration<float64, std::milli>(now - start).count();
+    start = now;
+    return ms;
+}
+
+/** \brief 是否使用整数视差代价体：须强制Frontal-Parallel且为整像素视差，视差范围有效 */
+static bool isCostVolumeEnabled(const PMSOption &option) {
+    return option._isUseCostVolume && option._isForceFpw && option._isIntegerDisp &&
+           option._maxDisparity >= option._minDisparity;
+}
 
 PatchMatchStereo::PatchMatchStereo() : _width(0), _height(0), _imgLeft(nullptr), _imgRight(nullptr),
                                        _grayLeft(nullptr), _grayRight(nullptr),
                                        _gradLeft(nullptr), _gradRight(nullptr),
+                                       _censusLeft(nullptr), _censusRight(nullptr),
                                        _costLeft(nullptr), _costRight(nullptr),
                                        _dispLeft(nullptr), _dispRight(nullptr),
                                        _planeLeft(nullptr), _planeRight(nullptr),
+                                       _imgCoarseLeft(nullptr), _imgCoarseRight(nullptr),
+                                       _frameIndex(0), _isTemporalFrame(false),
                                        _isInitialized(false) {
 
 }
@@ -26,6 +49,8 @@ bool PatchMatchStereo::initialize(const sint32 &width, const sint32 &height, con
     // 影像尺寸
     _width = width;
     _height = height;
+    // 新的视频序列
+    resetSequence();
     // PMS参数
     _option = option;
 
@@ -34,43 +59,137 @@ bool PatchMatchStereo::initialize(const sint32 &width, const sint32 &height, con
     }
 
     //··· 开辟内存空间
-    const sint32 size = width * height;
-    // 灰度数据
-    _grayLeft = new uint8[size];
-    _grayRight = new uint8[size];
+    // 所有工作缓冲区由内存池统一分配，容量足够时复用
+    _isInitialized = false;
+    if (!_arena.reserve(getMemoryFootprint(width, height, option))) {
+        release();
+        return false;
+    }
+
+    const uint64 size = uint64(width) * uint64(height);
+    // 灰度数据，只在需要输出时分配
+    const bool isGray = option._isKeepGray;
+    _grayLeft = isGray ? _arena.allocate<uint8>(size) : nullptr;
+    _grayRight = isGray ? _arena.allocate<uint8>(size) : nullptr;
     // 梯度数据
-    _gradLeft = new PGradient[size];
-    _gradRight = new PGradient[size];
-    // 代价数据
-    _costLeft = new float32[size];
-    _costRight = new float32[size];
-    // 视差图
-    _dispLeft = new float32[size];
-    _dispRight = new float32[size];
-    // 平面集
-    _planeLeft = new DisparityPlane[size];
-    _planeRight = new DisparityPlane[size];
-
-    _isInitialized = _grayLeft && _grayRight &&
-                     _gradLeft && _gradRight &&
-                     _costLeft && _costRight &&
-                     _dispLeft && _dispRight &&
-                     _planeLeft && _planeRight;
+    _gradLeft = _arena.allocate<PGradient>(size);
+    _gradRight = _arena.allocate<PGradient>(size);
+    // Census编码，只在使用Census代价时分配
+    const bool isCensus = (option._costType == PMS_COST_CENSUS);
+    _censusLeft = isCensus ? _arena.allocate<uint64>(size) : nullptr;
+    _censusRight = isCensus ? _arena.allocate<uint64>(size) : nullptr;
+    // 分平面特征，只有PMS代价计算器读取，只在使用PMS代价时分配
+    _featureLeft.release();
+    _featureRight.release();
+    const bool isFeature = (option._costType == PMS_COST_PMS);
+    const bool isFeatureReady = !isFeature ||
+                                (_featureLeft.allocate(_arena, width, height, option._patchSize) &&
+                                 _featureRight.allocate(_arena, width, height, option._patchSize));
+    // 代价数据、视差图、平面集，只计算左视图时不分配右视图部分
+    const bool isRight = !option._isLeftOnly;
+    _costLeft = _arena.allocate<float32>(size);
+    _costRight = isRight ? _arena.allocate<float32>(size) : nullptr;
+    _dispLeft = _arena.allocate<float32>(size);
+    _dispRight = isRight ? _arena.allocate<float32>(size) : nullptr;
+    _planeLeft = _arena.allocate<DisparityPlane>(size);
+    _planeRight = isRight ? _arena.allocate<DisparityPlane>(size) : nullptr;
+    // 亚像素预插值特征，只在PMS代价启用且细分数有效时分配；
+    // 每个视图的代价计算器采样另一视图，只计算左视图时只需右影像的特征
+    _subpixelLeft.release();
+    _subpixelRight.release();
+    const bool isSubpixel = (option._costType == PMS_COST_PMS && PMSSubpixelImage::isValidStep(option._subpixelStep));
+    const bool isSubpixelReady = !isSubpixel ||
+                                 (_subpixelRight.allocate(_arena, width, height, option._subpixelStep) &&
+                                  (!isRight || _subpixelLeft.allocate(_arena, width, height, option._subpixelStep)));
+    // 金字塔粗层的降采样影像，只在使用金字塔时分配
+    const bool isPyramid = (option._numPyramidLevels > 1);
+    const uint64 sizeCoarse = uint64(width / 2) * uint64(height / 2) * 3;
+    _imgCoarseLeft = isPyramid ? _arena.allocate<uint8>(sizeCoarse) : nullptr;
+    _imgCoarseRight = isPyramid ? _arena.allocate<uint8>(sizeCoarse) : nullptr;
+    // 支持权值缓存，只在启用时分配
+    _weightCacheLeft.release();
+    _weightCacheRight.release();
+    const bool isCache = !option._isUseWeightCache ||
+                         (_weightCacheLeft.allocate(_arena, width, height, option._patchSize) &&
+                          (!isRight || _weightCacheRight.allocate(_arena, width, height, option._patchSize)));
+
+    // 整数视差聚合代价体，只在强制Frontal-Parallel且为整像素视差并启用时分配
+    _costVolumeLeft.release();
+    _costVolumeRight.release();
+    const sint32 numDisparities = option._maxDisparity - option._minDisparity + 1;
+    const bool isCostVolume = isCostVolumeEnabled(option);
+    const bool isCostVolumeReady = !isCostVolume ||
+                                   (_costVolumeLeft.allocate(_arena, width, height, numDisparities) &&
+                                    (!isRight || _costVolumeRight.allocate(_arena, width, height, numDisparities)));
+
+    _isInitialized = (!isGray || (_grayLeft && _grayRight)) &&
+                     _gradLeft && _gradRight && (!isCensus || (_censusLeft && _censusRight)) &&
+                     isFeatureReady && isCache && isSubpixelReady && isCostVolumeReady &&
+                     (!isPyramid || (_imgCoarseLeft && _imgCoarseRight)) &&
+                     _costLeft && _dispLeft && _planeLeft &&
+                     (!isRight || (_costRight && _dispRight && _planeRight));
 
     return _isInitialized;
 }
 
+bool PatchMatchStereo::reset(const uint32 &width, const uint32 &height, const PMSOption &option) {
+    // 内存池容量足够时不重新分配
+    return initialize(sint32(width), sint32(height), option);
+}
+
+uint64 PatchMatchStereo::getMemoryFootprint(const sint32 &width, const sint32 &height, const PMSOption &option) {
+    if (width <= 0 || height <= 0) {
+        return 0;
+    }
+    const uint64 size = uint64(width) * uint64(height);
+    // 梯度数据左右视图均需要，灰度数据只在需要输出时分配，Census编码只在使用Census代价时分配，
+    // 分平面特征只在使用PMS代价时分配；
+    // 代价、视差图、平面集、支持权值缓存、亚像素特征及代价体只计算左视图时只需一份
+    const uint64 numViews = option._isLeftOnly ? 1 : 2;
+    const uint64 grayBytes = option._isKeepGray ? PMSArena::alignUp(size * sizeof(uint8)) : 0;
+    const uint64 censusBytes = (option._costType == PMS_COST_CENSUS) ?
+                               PMSArena::alignUp(size * sizeof(uint64)) : 0;
+    const uint64 cacheBytes = option._isUseWeightCache ?
+                              PMSWeightCache::getMemoryBytes(width, height, option._patchSize) : 0;
+    const uint64 featureBytes = (option._costType == PMS_COST_PMS) ?
+                                PMSFeatureImage::getMemoryBytes(width, height, option._patchSize) : 0;
+    const uint64 subpixelBytes = (option._costType == PMS_COST_PMS) ?
+                                 PMSSubpixelImage::getMemoryBytes(width, height, option._subpixelStep) : 0;
+    const uint64 volumeBytes = isCostVolumeEnabled(option) ?
+                               PMSCostVolume::getMemoryBytes(width, height,
+                                                             option._maxDisparity - option._minDisparity + 1) : 0;
+    // 金字塔粗层实例有各自的内存池，本层只需保存降采样影像
+    const uint64 coarseBytes = (option._numPyramidLevels > 1) ?
+                               PMSArena::alignUp(uint64(width / 2) * uint64(height / 2) * 3) : 0;
+    return 2 * (grayBytes + PMSArena::alignUp(size * sizeof(PGradient)) + censusBytes + featureBytes + coarseBytes) +
+           numViews * (2 * PMSArena::alignUp(size * sizeof(float32)) +
+                       PMSArena::alignUp(size * sizeof(DisparityPlane)) + cacheBytes + subpixelBytes +
+                       volumeBytes);
+}
+
+uint64 PatchMatchStereo::getMemoryFootprint() const {
+    return _arena.getCapacity();
+}
+
 void PatchMatchStereo::release() {
-    SAFE_DELETE(_grayLeft);
-    SAFE_DELETE(_grayRight);
-    SAFE_DELETE(_gradLeft);
-    SAFE_DELETE(_gradRight);
-    SAFE_DELETE(_costLeft);
-    SAFE_DELETE(_costRight);
-    SAFE_DELETE(_dispLeft);
-    SAFE_DELETE(_dispRight);
-    SAFE_DELETE(_planeLeft);
-    SAFE_DELETE(_planeRight);
+    _grayLeft = _grayRight = nullptr;
+    _gradLeft = _gradRight = nullptr;
+    _censusLeft = _censusRight = nullptr;
+    _featureLeft.release();
+    _featureRight.release();
+    _weightCacheLeft.release();
+    _weightCacheRight.release();
+    _subpixelLeft.release();
+    _subpixelRight.release();
+    _costVolumeLeft.release();
+    _costVolumeRight.release();
+    _costLeft = _costRight = nullptr;
+    _dispLeft = _dispRight = nullptr;
+    _planeLeft = _planeRight = nullptr;
+    _imgCoarseLeft = _imgCoarseRight = nullptr;
+    _pyramidEngine.reset();
+    _arena.release();
+    _isInitialized = false;
 }
 
 bool PatchMatchStereo::match(const uint8 *imgLeft, const uint8 *imgRight, float32 *dispLeft, float32 *dispRight) {
@@ -83,29 +202,119 @@ bool PatchMatchStereo::match(const uint8 *imgLeft, const uint8 *imgRight, float3
 
     _imgLeft = imgLeft;
     _imgRight = imgRight;
-
-    // 随机初始化
-    randomInitialization();
-    // 计算灰度图
-    computeGray();
-    // 计算梯度图
+    _statistics = PMSStatistics();
+    _timings = PMSTimings();
+    auto begin = std::chrono::steady_clock::now();
+    auto start = begin;
+
+    // 由粗到精的金字塔初始化
+    const bool isPyramid = (_option._numPyramidLevels > 1) && pyramidInitialization();
+    _timings._pyramid = elapsedMs(start);
+    // 随机初始化，只在未使用金字塔或金字塔不可用（影像过小、粗层匹配失败）时执行
+    if (!isPyramid) {
+        randomInitialization();
+    }
+    _timings._initialization = elapsedMs(start);
+    // 计算梯度图（灰度转换与梯度计算融合）
     computeGradient();
+    _timings._computeGradient = elapsedMs(start);
+    // 构建分平面特征
+    computeFeatures();
+    _timings._computeFeatures = elapsedMs(start);
 
     // 迭代传播
     propagation();
+    _timings._propagation = elapsedMs(start);
+
+    // 后处理并输出视差图
+    outputDisparity(dispLeft, dispRight);
+
+    _timings._total = elapsedMs(begin);
+    return true;
+}
+
+bool PatchMatchStereo::matchFrame(const uint8 *imgLeft, const uint8 *imgRight,
+                                  float32 *dispLeft, float32 *dispRight) {
+    if (!_isInitialized) {
+        return false;
+    }
+    if (imgLeft == nullptr || imgRight == nullptr) {
+        return false;
+    }
+
+    // 首帧按单帧完整匹配
+    if (_frameIndex == 0) {
+        if (!match(imgLeft, imgRight, dispLeft, dispRight)) {
+            return false;
+        }
+        _frameIndex++;
+        return true;
+    }
+
+    _imgLeft = imgLeft;
+    _imgRight = imgRight;
+    _statistics = PMSStatistics();
+    _timings = PMSTimings();
+    auto begin = std::chrono::steady_clock::now();
+    auto start = begin;
+
+    // 以上一帧的平面为初值
+    temporalInitialization();
+    _timings._initialization = elapsedMs(start);
+    // 计算梯度图（灰度转换与梯度计算融合）
+    computeGradient();
+    _timings._computeGradient = elapsedMs(start);
+    // 构建分平面特征
+    computeFeatures();
+    _timings._computeFeatures = elapsedMs(start);
+
+    // 时序传播及迭代传播
+    _isTemporalFrame = true;
+    propagation();
+    _isTemporalFrame = false;
+    _timings._propagation = elapsedMs(start);
+
+    // 后处理并输出视差图
+    outputDisparity(dispLeft, dispRight);
+
+    _timings._total = elapsedMs(begin);
+
+    _frameIndex++;
+    return true;
+}
+
+void PatchMatchStereo::resetSequence() {
+    _frameIndex = 0;
+    _isTemporalFrame = false;
+    _planePrevLeft.clear();
+    _planePrevLeft.shrink_to_fit();
+    _planePrevRight.clear();
+    _planePrevRight.shrink_to_fit();
+}
+
+void PatchMatchStereo::outputDisparity(float32 *dispLeft, float32 *dispRight) {
+    auto start = std::chrono::steady_clock::now();
 
     // 平面转换成视差
     planeToDisparity();
+    _timings._planeToDisparity = elapsedMs(start);
 
     // 左右一致性检查
-    if (_option._isCheckLR) {
+    if (_option._isCheckLR && !_option._isLeftOnly) {
         // 一致性检查
         lrCheck();
+        _statistics._numLRMismatches = countMismatches();
+    } else {
+        // 未做一致性检查时没有待填充像素
+        _mismatchesLeft.clear();
+        _mismatchesRight.clear();
     }
+    _timings._lrCheck = elapsedMs(start);
     // 视差填充
     if (_option._isFillHoles) {
         fillHolesInDispMap();
     }
+    _timings._fillHoles = elapsedMs(start);
 
     // 输出视差图
     if (_dispLeft && dispLeft) {
@@ -114,8 +323,38 @@ bool PatchMatchStereo::match(const uint8 *imgLeft, const uint8 *imgRight, float3
     if (_dispRight && dispRight) {
         memcpy(dispRight, _dispRight, _height * _width * sizeof(float32));
     }
+}
 
-    return true;
+const PMSStatistics &PatchMatchStereo::getStatistics() const {
+    return _statistics;
+}
+
+const PMSTimings &PatchMatchStereo::getTimings() const {
+    return _timings;
+}
+
+sint32 PatchMatchStereo::getWidth() const {
+    return _width;
+}
+
+sint32 PatchMatchStereo::getHeight() const {
+    return _height;
+}
+
+const float32 *PatchMatchStereo::getDisparityMap(const sint32 &view) const {
+    return view == 0 ? _dispLeft : _dispRight;
+}
+
+const DisparityPlane *PatchMatchStereo::getDisparityPlanes(const sint32 &view) const {
+    return view == 0 ? _planeLeft : _planeRight;
+}
+
+const float32 *PatchMatchStereo::getCostMap(const sint32 &view) const {
+    return view == 0 ? _costLeft : _costRight;
+}
+
+const uint8 *PatchMatchStereo::getGrayMap(const sint32 &view) const {
+    return view == 0 ? _grayLeft : _grayRight;
 }
 
 void PatchMatchStereo::randomInitialization() {
@@ -124,120 +363,191 @@ void PatchMatchStereo::randomInitialization() {
 
 
     if (width <= 0 || height <= 0 ||
-        _dispLeft == nullptr || _dispRight == nullptr ||
-        _planeLeft == nullptr || _planeRight == nullptr) {
+        _dispLeft == nullptr || _planeLeft == nullptr) {
         return;
     }
 
     const PMSOption &option = _option;
-    const sint32 minDisparity = option._minDisparity;
-    const sint32 maxDisparity = option._maxDisparity;
-
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float32> randDisp(static_cast<float32>(minDisparity),
-                                                     static_cast<float32>(maxDisparity));
-    std::uniform_real_distribution<float32> randNorm(-1.0f, 1.0f);
+    const sint32 numViews = (_planeRight != nullptr) ? 2 : 1;
 
-    for (sint32 k = 0; k < 2; k++) {
+    for (sint32 k = 0; k < numViews; k++) {
         float32 *dispPtr = k == 0 ? _dispLeft : _dispRight;
         DisparityPlane *planePtr = k == 0 ? _planeLeft : _planeRight;
-        float32 sign = (k == 0) ? 1.0f : -1.0f;
 
         for (sint32 y = 0; y < _height; ++y) {
             for (sint32 x = 0; x < _width; ++x) {
-                const sint32 p = y * width + x;;
+                const sint32 p = y * width + x;
 
-                // 随机视差值
-                float32 disp = sign * randDisp(gen);
-                if (option._isIntegerDisp) {
-                    disp = static_cast<float32>(round(disp));
-                }
-                dispPtr[p] = disp;
-
-                // 随机法向量
-                PVector3f norm;
-                if (!option._isForceFpw) {
-                    norm._x = randNorm(gen);
-                    norm._y = randNorm(gen);
-                    float32 z = randNorm(gen);
-                    while (z == 0.0f) {
-                        z = randNorm(gen);
-                    }
-                    norm._z = z;
-                    norm.normalize();
-                } else {
-                    norm._x = 0.0f;
-                    norm._y = 0.0f;
-                    norm._z = 1.0f;
-                }
+                // 随机数生成器，由种子、视图及像素位置确定
+                PMSRandom rng(option._seed, PMSRandom::makeKey(uint32(k), uint32(p)));
 
-                // 计算视差平面
-                planePtr[p] = DisparityPlane(x, y, norm, disp);
+                planePtr[p] = randomPlane(x, y, k, rng, dispPtr[p]);
             }
         }
     }
 }
 
-void PatchMatchStereo::computeGray() {
+DisparityPlane PatchMatchStereo::randomPlane(const sint32 &x, const sint32 &y, const sint32 &k, PMSRandom &rng,
+                                             float32 &disp) const {
+    const PMSOption &option = _option;
+    const float32 sign = (k == 0) ? 1.0f : -1.0f;
+
+    // 随机视差值
+    disp = sign * rng.uniform(float32(option._minDisparity), float32(option._maxDisparity));
+    if (option._isIntegerDisp) {
+        disp = static_cast<float32>(round(disp));
+    }
+
+    // 随机法向量
+    PVector3f norm;
+    if (!option._isForceFpw) {
+        norm._x = rng.uniform(-1.0f, 1.0f);
+        norm._y = rng.uniform(-1.0f, 1.0f);
+        float32 z = rng.uniform(-1.0f, 1.0f);
+        while (z == 0.0f) {
+            z = rng.uniform(-1.0f, 1.0f);
+        }
+        norm._z = z;
+        norm.normalize();
+    } else {
+        norm._x = 0.0f;
+        norm._y = 0.0f;
+        norm._z = 1.0f;
+    }
+
+    // 计算视差平面
+    return DisparityPlane(x, y, norm, disp);
+}
+
+void PatchMatchStereo::temporalInitialization() {
     const sint32 width = _width;
     const sint32 height = _height;
     if (width <= 0 || height <= 0 ||
-        _imgLeft == nullptr || _imgRight == nullptr ||
-        _grayLeft == nullptr || _grayRight == nullptr) {
+        _dispLeft == nullptr || _planeLeft == nullptr) {
         return;
     }
 
-    // 彩色转灰度
-    for (sint32 n = 0; n < 2; n++) {
-        auto *color = (n == 0) ? _imgLeft : _imgRight;
-        auto *gray = (n == 0) ? _grayLeft : _grayRight;
-        for (sint32 i = 0; i < height; i++) {
-            for (sint32 j = 0; j < width; j++) {
-                const auto b = color[i * (width * 3) + (j * 3)];
-                const auto g = color[i * (width * 3) + (j * 3) + 1];
-                const auto r = color[i * (width * 3) + (j * 3) + 2];
-                gray[i * width + j] = uint8(r * 0.299 + g * 0.587 + b * 0.114);
+    const PMSOption &option = _option;
+    const sint32 numViews = (_planeRight != nullptr) ? 2 : 1;
+    // 每帧使用不同的随机序列
+    const uint64 seed = PMSRandom::mix(option._seed ^ PMSRandom::makeKey(uint32(_frameIndex), 0));
+
+    for (sint32 k = 0; k < numViews; k++) {
+        float32 *dispPtr = k == 0 ? _dispLeft : _dispRight;
+        DisparityPlane *planePtr = k == 0 ? _planeLeft : _planeRight;
+        auto &planePrev = (k == 0) ? _planePrevLeft : _planePrevRight;
+
+        // 保存上一帧平面，供时序传播作为候选
+        planePrev.assign(planePtr, planePtr + width * height);
+
+        for (sint32 y = 0; y < height; ++y) {
+            for (sint32 x = 0; x < width; ++x) {
+                const sint32 p = y * width + x;
+                PMSRandom rng(seed, PMSRandom::makeKey(uint32(k), uint32(p)));
+                if (rng.uniform(0.0f, 1.0f) < option._temporalRandomRatio) {
+                    planePtr[p] = randomPlane(x, y, k, rng, dispPtr[p]);
+                }
             }
         }
     }
 }
 
+bool PatchMatchStereo::pyramidInitialization() {
+    const sint32 width = _width;
+    const sint32 height = _height;
+    const sint32 widthC = width / 2;
+    const sint32 heightC = height / 2;
+
+    // 粗层参数：视差范围、Patch尺寸减半，仅需平面结果，关闭后处理
+    PMSOption optionC = _option;
+    optionC._minDisparity = static_cast<sint32>(std::floor(float32(_option._minDisparity) / 2.0f));
+    optionC._maxDisparity = static_cast<sint32>(std::ceil(float32(_option._maxDisparity) / 2.0f));
+    optionC._patchSize = std::max(3, (_option._patchSize / 2) | 1);
+    optionC._numIters = _option._numCoarseIters;
+    optionC._numPyramidLevels = _option._numPyramidLevels - 1;
+    optionC._isCheckLR = false;
+    optionC._isFillHoles = false;
+    optionC._isKeepGray = false;
+
+    if (widthC < optionC._patchSize || heightC < optionC._patchSize ||
+        _imgCoarseLeft == nullptr || _imgCoarseRight == nullptr) {
+        return false;
+    }
+
+    // 2x2均值降采样
+    for (sint32 k = 0; k < 2; k++) {
+        const uint8 *src = (k == 0) ? _imgLeft : _imgRight;
+        uint8 *dst = (k == 0) ? _imgCoarseLeft : _imgCoarseRight;
+        for (sint32 y = 0; y < heightC; y++) {
+            const uint8 *row0 = src + (2 * y) * (width * 3);
+            const uint8 *row1 = row0 + width * 3;
+            for (sint32 x = 0; x < widthC; x++) {
+                for (sint32 n = 0; n < 3; n++) {
+                    const sint32 sum = row0[6 * x + n] + row0[6 * x + 3 + n] + row1[6 * x + n] + row1[6 * x + 3 + n];
+                    dst[y * (widthC * 3) + x * 3 + n] = uint8((sum + 2) / 4);
+                }
+            }
+        }
+    }
+
+    // 粗层匹配（递归处理更粗的层），粗层实例在各次匹配间保留，内存池容量足够时不重新分配
+    if (!_pyramidEngine) {
+        _pyramidEngine.reset(new PatchMatchStereo());
+    }
+    PatchMatchStereo &pmsC = *_pyramidEngine;
+    if (!pmsC.reset(uint32(widthC), uint32(heightC), optionC) ||
+        !pmsC.match(_imgCoarseLeft, _imgCoarseRight, nullptr, nullptr)) {
+        return false;
+    }
+    _statistics += pmsC._statistics;
+
+    // 平面上采样作为本层初值
+    const sint32 numViews = (_planeRight != nullptr) ? 2 : 1;
+    for (sint32 k = 0; k < numViews; k++) {
+        const DisparityPlane *planeC = (k == 0) ? pmsC._planeLeft : pmsC._planeRight;
+        DisparityPlane *plane = (k == 0) ? _planeLeft : _planeRight;
+        for (sint32 y = 0; y < height; y++) {
+            const sint32 yC = std::min(y / 2, heightC - 1);
+            for (sint32 x = 0; x < width; x++) {
+                const sint32 xC = std::min(x / 2, widthC - 1);
+                plane[y * width + x] = planeC[yC * widthC + xC].toFinerLevel();
+            }
+        }
+    }
+    return true;
+}
+
 void PatchMatchStereo::computeGradient() {
     const sint32 width = _width;
     const sint32 height = _height;
     if (width <= 0 || height <= 0 ||
-        _gradLeft == nullptr || _gradRight == nullptr ||
-        _grayLeft == nullptr || _grayRight == nullptr) {
+        _imgLeft == nullptr || _imgRight == nullptr ||
+        _gradLeft == nullptr || _gradRight == nullptr) {
         return;
     }
 
-    // Sobel梯度算子
-    for (sint32 n = 0; n < 2; n++) {
-        auto *gray = (n == 0) ? _grayLeft : _grayRight;
-        auto *grad = (n == 0) ? _gradLeft : _gradRight;
-        for (sint32 y = 1; y < height - 1; y++) {
-            for (sint32 x = 1; x < width - 1; x++) {
-                const auto gradX =
-                        (-gray[(y - 1) * width + x - 1] + gray[(y - 1) * width + x + 1]) +
-                        (-2 * gray[y * width + x - 1] + 2 * gray[y * width + x + 1]) +
-                        (-gray[(y + 1) * width + x - 1] + gray[(y + 1) * width + x + 1]);
-                const auto gradY =
-                        (
-                                -gray[(y - 1) * width + x - 1]
-                                - 2 * gray[(y - 1) * width + x]
-                                - gray[(y - 1) * width + x + 1]
-                        ) +
-                        (
-                                gray[(y + 1) * width + x - 1] +
-                                2 * gray[(y + 1) * width + x] +
-                                gray[(y + 1) * width + x + 1]
-                        );
-                grad[y * width + x]._x = sint16(gradX / 8);
-                grad[y * width + x]._y = sint16(gradY / 8);
-            }
-        }
+    // 左右影像各划分为若干行带，所有行带作为独立任务并行计算
+    const sint32 numBands = (height + PREPROCESS_BAND_HEIGHT - 1) / PREPROCESS_BAND_HEIGHT;
+    parallelFor(0, 2 * numBands, _option._numThreads, [&](const sint32 &task, const sint32 &) {
+        const sint32 n = task / numBands;
+        const sint32 yBegin = (task % numBands) * PREPROCESS_BAND_HEIGHT;
+        const sint32 yEnd = std::min(yBegin + PREPROCESS_BAND_HEIGHT, height);
+        computeGradientBand((n == 0) ? _imgLeft : _imgRight, width, height, yBegin, yEnd,
+                            (n == 0) ? _gradLeft : _gradRight, (n == 0) ? _grayLeft : _grayRight,
+                            (n == 0) ? _censusLeft : _censusRight, _option._isUseSimd);
+    });
+}
+
+void PatchMatchStereo::computeFeatures() {
+    if (_width <= 0 || _height <= 0 || _imgLeft == nullptr || _imgRight == nullptr) {
+        return;
     }
+    // 只有PMS代价计算器读取特征
+    if (_option._costType != PMS_COST_PMS) {
+        return;
+    }
+    _featureLeft.build(_imgLeft, _gradLeft, _option._numThreads);
+    _featureRight.build(_imgRight, _gradRight, _option._numThreads);
 }
 
 void PatchMatchStereo::propagation() {
@@ -245,61 +555,264 @@ void PatchMatchStereo::propagation() {
     const sint32 height = _height;
     if (width <= 0 || height <= 0 ||
         _imgLeft == nullptr || _imgRight == nullptr ||
-        _grayLeft == nullptr || _grayRight == nullptr ||
-        _dispLeft == nullptr || _dispRight == nullptr ||
-        _planeLeft == nullptr || _planeRight == nullptr) {
+        _dispLeft == nullptr || _planeLeft == nullptr) {
         return;
     }
 
+    // 根据参数选择传播策略，每次匹配只选择一次
+    if (_option._costType == PMS_COST_CENSUS) {
+        propagationWithCost<CostComputerCensus>();
+    } else {
+        propagationWithCost<CostComputerPMS>();
+    }
+}
+
+template<typename CostCpt>
+void PatchMatchStereo::propagationWithCost() {
+    switch (_option._patchSize) {
+        case 21:
+            propagationWithPatchSize<CostCpt, 21>();
+            break;
+        case 35:
+            propagationWithPatchSize<CostCpt, 35>();
+            break;
+        default:
+            propagationWithPatchSize<CostCpt, 0>();
+            break;
+    }
+}
+
+template<typename CostCpt, sint32 PatchSize>
+void PatchMatchStereo::propagationWithPatchSize() {
+    if (_option._isForceFpw) {
+        if (_option._isIntegerDisp) {
+            runPropagation<PMSPolicy<CostCpt, PatchSize, true, true>>();
+        } else {
+            runPropagation<PMSPolicy<CostCpt, PatchSize, true, false>>();
+        }
+    } else {
+        if (_option._isIntegerDisp) {
+            runPropagation<PMSPolicy<CostCpt, PatchSize, false, true>>();
+        } else {
+            runPropagation<PMSPolicy<CostCpt, PatchSize, false, false>>();
+        }
+    }
+}
+
+template<typename Policy>
+void PatchMatchStereo::runPropagation() {
+    const sint32 width = _width;
+    const sint32 height = _height;
+
     // 左右视图匹配参数
-    const auto optionLeft = _option;
-    auto optionRight = _option;
+    auto optionLeft = _option;
+    if (_isTemporalFrame) {
+        // 视频模式：每帧使用不同的随机序列，迭代次数取_numTemporalIters
+        optionLeft._seed = PMSRandom::mix(_option._seed ^ PMSRandom::makeKey(uint32(_frameIndex), 1));
+        optionLeft._numIters = _option._numTemporalIters;
+    }
+    auto optionRight = optionLeft;
 
     optionRight._minDisparity = -optionLeft._maxDisparity;
     optionRight._maxDisparity = -optionLeft._minDisparity;
+    optionRight._seed = PMSRandom::mix(optionLeft._seed + 1);
+
+    // 只计算左视图时不构建右视图传播实例，也不做视图传播
+    const bool isRight = (_planeRight != nullptr);
+
+    // 支持权值缓存：由影像一次性构建，所有迭代复用
+    const PMSWeightCache *cacheLeft = nullptr;
+    const PMSWeightCache *cacheRight = nullptr;
+    if (_option._isUseWeightCache) {
+        if (_weightCacheLeft.build(_imgLeft, width, height, _option._patchSize, _option._gamma,
+                                   _option._weightCacheThres, 0, 0, width, height, _option._numThreads)) {
+            cacheLeft = &_weightCacheLeft;
+        }
+        if (isRight &&
+            _weightCacheRight.build(_imgRight, width, height, _option._patchSize, _option._gamma,
+                                    _option._weightCacheThres, 0, 0, width, height, _option._numThreads)) {
+            cacheRight = &_weightCacheRight;
+        }
+    }
+
+    // 代价计算器输入：左为本视图，右为另一视图
+    PMSCostInput inputLeft;
+    inputLeft._imgLeft = _imgLeft;
+    inputLeft._imgRight = _imgRight;
+    inputLeft._gradLeft = _gradLeft;
+    inputLeft._gradRight = _gradRight;
+    inputLeft._censusLeft = _censusLeft;
+    inputLeft._censusRight = _censusRight;
+    inputLeft._width = width;
+    inputLeft._height = height;
+    inputLeft._minDisparity = optionLeft._minDisparity;
+    inputLeft._maxDisparity = optionLeft._maxDisparity;
+    inputLeft._weightCache = cacheLeft;
+    PMSCostInput inputRight = inputLeft;
+    std::swap(inputRight._imgLeft, inputRight._imgRight);
+    std::swap(inputRight._gradLeft, inputRight._gradRight);
+    std::swap(inputRight._censusLeft, inputRight._censusRight);
+    inputRight._minDisparity = optionRight._minDisparity;
+    inputRight._maxDisparity = optionRight._maxDisparity;
+    inputRight._weightCache = cacheRight;
+
+    // 整数视差代价体：平面只能取有限个整数视差时，一次性聚合全部视差，传播中查表
+    if (Policy::isForceFpw && Policy::isIntegerDisp && isCostVolumeEnabled(_option)) {
+        const float32 costMax = (1.0f - _option._alpha) * _option._tauCol + _option._alpha * _option._tauGrad;
+        auto costCptLeft = Policy::createCostComputer(_option, inputLeft);
+        if (_costVolumeLeft.build(costCptLeft, _imgLeft, width, height, _option._patchSize, _option._gamma,
+                                  optionLeft._minDisparity, optionLeft._maxDisparity, costMax, cacheLeft,
+                                  _option._numThreads, _option._isUseSimd)) {
+            inputLeft._costVolume = &_costVolumeLeft;
+        }
+        if (isRight) {
+            auto costCptRight = Policy::createCostComputer(_option, inputRight);
+            if (_costVolumeRight.build(costCptRight, _imgRight, width, height, _option._patchSize, _option._gamma,
+                                       optionRight._minDisparity, optionRight._maxDisparity, costMax, cacheRight,
+                                       _option._numThreads, _option._isUseSimd)) {
+                inputRight._costVolume = &_costVolumeRight;
+            }
+        }
+    }
+
+    // 亚像素预插值：每个视图的代价计算器采样另一视图的影像
+    if (_subpixelRight.build(_imgRight, _gradRight, _option._numThreads)) {
+        inputLeft._subpixelImage = &_subpixelRight;
+    }
+    if (isRight && _subpixelLeft.build(_imgLeft, _gradLeft, _option._numThreads)) {
+        inputRight._subpixelImage = &_subpixelLeft;
+    }
+
+    // 分平面特征：每个视图的代价计算器读取本视图影像的特征
+    if (_option._costType == PMS_COST_PMS) {
+        inputLeft._featureImage = &_featureLeft;
+        inputRight._featureImage = &_featureRight;
+    }
 
     // 左右视图传播实例
-    PMSPropagation propaLeft(optionLeft,
-                             width, height,
-                             _imgLeft, _imgRight,
-                             _gradLeft, _gradRight,
-                             _planeLeft, _planeRight,
-                             _costLeft, _costRight,
-                             _dispLeft);
-    PMSPropagation propaRight(optionRight,
-                              width, height,
-                              _imgRight, _imgLeft,
-                              _gradRight, _gradLeft,
-                              _planeRight, _planeLeft,
-                              _costRight, _costLeft,
-                              _dispRight);
+    PMSPropagation<Policy> propaLeft(optionLeft, inputLeft, inputRight,
+                                     _planeLeft, _planeRight,
+                                     _costLeft, _costRight,
+                                     _dispLeft);
+    std::unique_ptr<PMSPropagation<Policy>> propaRight;
+    if (isRight) {
+        propaRight.reset(new PMSPropagation<Policy>(optionRight, inputRight, inputLeft,
+                                                    _planeRight, _planeLeft,
+                                                    _costRight, _costLeft,
+                                                    _dispRight));
+    }
+
+    // 时序传播：以上一帧的平面作为候选
+    if (_isTemporalFrame) {
+        propaLeft.doTemporalPropagation(_planePrevLeft.data());
+        if (propaRight) {
+            propaRight->doTemporalPropagation(_planePrevRight.data());
+        }
+    }
 
     // 迭代传播
-    for (sint32 k = 0; k < _option._numIters; k++) {
+    for (sint32 k = 0; k < optionLeft._numIters; k++) {
+        auto start = std::chrono::steady_clock::now();
         propaLeft.doPropagation();
-        propaRight.doPropagation();
+        if (propaRight) {
+            propaRight->doPropagation();
+        }
+        _timings._iterations.push_back(elapsedMs(start));
+
+        // 活动像素比例低于阈值时认为已收敛，提前结束迭代
+        if (_option._isUseActiveSet && _option._activeSetThres > 0.0f) {
+            const float32 ratio = std::max(propaLeft.getActiveRatio(),
+                                           propaRight ? propaRight->getActiveRatio() : 0.0f);
+            if (ratio < _option._activeSetThres) {
+                break;
+            }
+        }
+    }
+
+    _statistics += propaLeft.getStatistics();
+    if (propaRight) {
+        _statistics += propaRight->getStatistics();
+    }
+
+    // 缓存只在本次匹配中有效
+    _weightCacheLeft.clear();
+    _weightCacheRight.clear();
+    _costVolumeLeft.clear();
+    _costVolumeRight.clear();
+    _subpixelLeft.clear();
+    _subpixelRight.clear();
+}
+
+/** \brief 一行像素由平面计算视差 */
+static void planeRowToDisparity(const DisparityPlane *planes, const sint32 &y, const sint32 &width,
+                                float32 *disp) {
+    for (sint32 x = 0; x < width; x++) {
+        disp[x] = planes[x].getDisparity(x, y);
+    }
+}
+
+#ifdef PMS_USE_AVX2
+/**
+ * \brief 一行像素由平面计算视差（AVX2实现，每次处理8个像素），尾部交由标量实现
+ * 按 (a*x + b*y) + c*1 的顺序计算，与DisparityPlane::getDisparity逐位一致
+ */
+__attribute__((target("avx2")))
+static void planeRowToDisparityAVX2(const DisparityPlane *planes, const sint32 &y, const sint32 &width,
+                                    float32 *disp) {
+    static_assert(sizeof(DisparityPlane) == 3 * sizeof(float32), "plane must be three packed floats");
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 yF = _mm256_set1_ps(float32(y));
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    sint32 x = 0;
+    for (; x + 8 <= width; x += 8) {
+        // 8个平面共24个浮点数，按128位读入后重排为a、b、c三个向量：
+        // m03、m14、m25的低128位依次为第0~3个平面，高128位依次为第4~7个平面
+        const auto *p = reinterpret_cast<const float32 *>(planes + x);
+        const __m256 m03 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 12), 1);
+        const __m256 m14 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+        const __m256 m25 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+        const __m256 ab = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+        const __m256 bc = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+        const __m256 a = _mm256_shuffle_ps(m03, ab, _MM_SHUFFLE(2, 0, 3, 0));
+        const __m256 b = _mm256_shuffle_ps(bc, ab, _MM_SHUFFLE(3, 1, 2, 0));
+        const __m256 c = _mm256_shuffle_ps(bc, m25, _MM_SHUFFLE(3, 0, 3, 1));
+        const __m256 xF = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x), lane));
+        const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, xF), _mm256_mul_ps(b, yF)),
+                                       _mm256_mul_ps(c, one));
+        _mm256_storeu_ps(disp + x, d);
+    }
+    for (; x < width; x++) {
+        disp[x] = planes[x].getDisparity(x, y);
     }
 }
+#endif
 
 void PatchMatchStereo::planeToDisparity() {
     const sint32 width = _width;
     const sint32 height = _height;
     if (width <= 0 || height <= 0 ||
-        _dispLeft == nullptr || _dispRight == nullptr ||
-        _planeLeft == nullptr || _planeRight == nullptr) {
+        _dispLeft == nullptr || _planeLeft == nullptr) {
         return;
     }
-    for (int k = 0; k < 2; k++) {
-        auto *planePtr = (k == 0) ? _planeLeft : _planeRight;
-        auto *dispPtr = (k == 0) ? _dispLeft : _dispRight;
-        for (sint32 y = 0; y < height; y++) {
-            for (sint32 x = 0; x < width; x++) {
-                const sint32 p = y * width + x;
-                const auto &plane = planePtr[p];
-                dispPtr[p] = plane.getDisparity(x, y);
-            }
+#ifdef PMS_USE_AVX2
+    const bool isSimd = _option._isUseSimd && CostComputerPMS::isSimdSupported();
+#endif
+    // 左右视图的各行作为独立任务并行计算
+    const sint32 numViews = (_planeRight != nullptr) ? 2 : 1;
+    parallelFor(0, numViews * height, _option._numThreads, [&](const sint32 &task, const sint32 &) {
+        const sint32 k = task / height;
+        const sint32 y = task % height;
+        const auto *planeRow = ((k == 0) ? _planeLeft : _planeRight) + size_t(y) * width;
+        auto *dispRow = ((k == 0) ? _dispLeft : _dispRight) + size_t(y) * width;
+#ifdef PMS_USE_AVX2
+        if (isSimd) {
+            planeRowToDisparityAVX2(planeRow, y, width, dispRow);
+            return;
         }
-    }
+#endif
+        planeRowToDisparity(planeRow, y, width, dispRow);
+    });
 }
 
 void PatchMatchStereo::lrCheck() {
@@ -307,39 +820,47 @@ void PatchMatchStereo::lrCheck() {
     const sint32 height = _height;
 
     const float32 &threshold = _option._lrCheckThres;
+    const sint32 numWords = getMismatchWordsPerRow();
 
     // k==0 : 左视图一致性检查
-    // k==1 : 右视图一致性检查
+    // k==1 : 右视图一致性检查，使用左视图检查后的视差，两次检查须依次进行
     for (int k = 0; k < 2; k++) {
         auto *dispLeft = (k == 0) ? _dispLeft : _dispRight;
         auto *dispRight = (k == 0) ? _dispRight : _dispLeft;
         auto &mismatches = (k == 0) ? _mismatchesLeft : _mismatchesRight;
-        mismatches.clear();
+        mismatches.assign(size_t(numWords) * height, 0);
 
-        // ---左右一致性检查
-        for (sint32 y = 0; y < height; y++) {
+        // ---左右一致性检查，各行只读写本行数据，按行并行
+        parallelFor(0, height, _option._numThreads, [&](const sint32 &y, const sint32 &) {
+            float32 *dispRowL = dispLeft + size_t(y) * width;
+            const float32 *dispRowR = dispRight + size_t(y) * width;
+            uint64 *maskRow = mismatches.data() + size_t(y) * numWords;
             for (sint32 x = 0; x < width; x++) {
-                auto &dispL = dispLeft[y * width + x];
-                if (dispL == Invalid_Float) {
-                    mismatches.emplace_back(x, y);
-                    continue;
-                }
-
-                sint32 xr = lround(float64(x) - dispL);
-                if (xr < 0 || xr >= width) {
-                    dispL = Invalid_Float;
-                    mismatches.emplace_back(x, y);
-                } else {
-                    auto &dispR = dispRight[y * width + xr];
-                    if (std::abs(dispL + dispR) > threshold) {
+                auto &dispL = dispRowL[x];
+                bool isMismatch = (dispL == Invalid_Float);
+                if (!isMismatch) {
+                    const sint32 xr = lround(float64(x) - dispL);
+                    isMismatch = (xr < 0 || xr >= width) || std::abs(dispL + dispRowR[xr]) > threshold;
+                    if (isMismatch) {
                         dispL = Invalid_Float;
-                        mismatches.emplace_back(x, y);
                     }
                 }
+                if (isMismatch) {
+                    maskRow[x / 64] |= uint64(1) << (x % 64);
+                }
             }
-        }
+        });
     }
+}
 
+uint64 PatchMatchStereo::countMismatches() const {
+    uint64 count = 0;
+    for (const auto *mismatches: {&_mismatchesLeft, &_mismatchesRight}) {
+        for (const uint64 &word: *mismatches) {
+            count += std::bitset<64>(word).count();
+        }
+    }
+    return count;
 }
 
 void PatchMatchStereo::fillHolesInDispMap() {
@@ -351,64 +872,68 @@ void PatchMatchStereo::fillHolesInDispMap() {
         return;
     }
 
-    const auto &option = _option;
+    const sint32 numWords = getMismatchWordsPerRow();
+    // 各线程的行缓冲：每个像素右侧最近的有效像素列号
+    std::vector<std::vector<sint32>> nextValidBuffers(resolveThreadCount(_option._numThreads));
 
     // k==0 : 左视图视差填充
     // k==1 : 右视图视差填充
     for (int k = 0; k < 2; k++) {
-        auto &mismatches = (k == 0) ? _mismatchesLeft : _mismatchesRight;
-        if (mismatches.empty()) {
+        const auto &mismatches = (k == 0) ? _mismatchesLeft : _mismatchesRight;
+        if (mismatches.size() != size_t(numWords) * height) {
             continue;
         }
 
-        const auto *imgPtr = (k == 0) ? _imgLeft : _imgRight;
         const auto *planePtr = (k == 0) ? _planeLeft : _planeRight;
         auto *dispPtr = (k == 0) ? _dispLeft : _dispRight;
-        std::vector<float32> fillDisps(mismatches.size());  // 存储每个待填充像素的视差
-
-        for (int n = 0; n < mismatches.size(); ++n) {
-            auto &pixel = mismatches[n];
-            const sint32 x = pixel.first;
-            const sint32 y = pixel.second;
-
-            std::vector<DisparityPlane> planes;
-            // 向左向右各搜寻第一个有效像素，记录平面
-            sint32 xr = x + 1;
-            while (xr < width) {
-                if (dispPtr[y * width + xr] != Invalid_Float) {
-                    planes.push_back(planePtr[y * width + xr]);
-                    break;
-                }
-                xr++;
+
+        // 每行两次线性扫描：自右向左记录各像素右侧最近的有效像素，再自左向右边维护左侧最近的有效像素边填充，
+        // 有效性按填充前的视差判断
+        parallelFor(0, height, _option._numThreads, [&](const sint32 &y, const sint32 &tid) {
+            const uint64 *maskRow = mismatches.data() + size_t(y) * numWords;
+            bool isAny = false;
+            for (sint32 w = 0; w < numWords && !isAny; w++) {
+                isAny = (maskRow[w] != 0);
+            }
+            if (!isAny) {
+                return;
             }
 
-            sint32 xl = x - 1;
-            while (xl >= 0) {
-                if (dispPtr[y * width + xl] != Invalid_Float) {
-                    planes.push_back(planePtr[y * width + xl]);
-                    break;
+            const DisparityPlane *planeRow = planePtr + size_t(y) * width;
+            float32 *dispRow = dispPtr + size_t(y) * width;
+            auto &nextValid = nextValidBuffers[tid];
+            nextValid.resize(width);
+            sint32 next = -1;
+            for (sint32 x = width - 1; x >= 0; x--) {
+                nextValid[x] = next;
+                if (dispRow[x] != Invalid_Float) {
+                    next = x;
                 }
-                xl--;
             }
 
-            if (planes.empty()) {
-                continue;
-            } else if (planes.size() == 1) {
-                fillDisps[n] = (planes[0].getDisparity(x, y));
-            } else {
-                // 选择较小的视差
-                const auto dispR = planes[0].getDisparity(x, y);
-                const auto dispL = planes[1].getDisparity(x, y);
-                fillDisps[n] = dispR < dispL ? dispR : dispL;
+            sint32 prev = -1;
+            for (sint32 x = 0; x < width; x++) {
+                const bool isValid = (dispRow[x] != Invalid_Float);
+                if ((maskRow[x / 64] >> (x % 64)) & 1) {
+                    // 两侧均有有效像素时选择较小的视差，均无时置0
+                    const sint32 xr = nextValid[x];
+                    const sint32 xl = prev;
+                    float32 fill = 0.0f;
+                    if (xr >= 0 && xl >= 0) {
+                        const auto dispR = planeRow[xr].getDisparity(x, y);
+                        const auto dispL = planeRow[xl].getDisparity(x, y);
+                        fill = dispR < dispL ? dispR : dispL;
+                    } else if (xr >= 0) {
+                        fill = planeRow[xr].getDisparity(x, y);
+                    } else if (xl >= 0) {
+                        fill = planeRow[xl].getDisparity(x, y);
+                    }
+                    dispRow[x] = fill;
+                }
+                if (isValid) {
+                    prev = x;
+                }
             }
-        }
-
-        for (int n = 0; n < mismatches.size(); ++n) {
-            auto &pixel = mismatches[n];
-            const sint32 x = pixel.first;
-            const sint32 y = pixel.second;
-            dispPtr[y * width + x] = fillDisps[n];
-        }
-
+        });
     }
 }
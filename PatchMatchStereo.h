@@ -7,9 +7,15 @@
 
 #include "PMSPropagation.h"
 #include "PMSType.h"
+#include "PMSRandom.h"
+#include "PMSWeightCache.h"
+#include "PMSCostVolume.h"
+#include "PMSSubpixelImage.h"
+#include "PMSFeatureImage.h"
+#include "PMSArena.h"
 #include <vector>
+#include <memory>
 #include <ctime>
-#include <random>
 
 class PatchMatchStereo {
 public:
@@ -30,36 +36,147 @@ public:
     * \param img_left	输入，左影像数据指针，3通道
     * \param img_right	输入，右影像数据指针，3通道
     * \param disp_left	输出，左影像视差图指针，预先分配和影像等尺寸的内存空间
+    * \param disp_right	输出，右影像视差图指针，预先分配和影像等尺寸的内存空间；只计算左视图时不输出
     */
     bool match(const uint8 *imgLeft, const uint8 *imgRight, float32 *dispLeft, float32 *dispRight);
 
     /**
-    * \brief 重设
+    * \brief 视频模式匹配：首帧同match，之后各帧以上一帧的平面为初值（混合部分随机平面），
+    * 经时序传播及_numTemporalIters次传播得到结果
+    * \param img_left	输入，当前帧左影像数据指针，3通道
+    * \param img_right	输入，当前帧右影像数据指针，3通道
+    * \param disp_left	输出，左影像视差图指针，预先分配和影像等尺寸的内存空间
+    * \param disp_right	输出，右影像视差图指针，预先分配和影像等尺寸的内存空间；只计算左视图时不输出
+    */
+    bool matchFrame(const uint8 *imgLeft, const uint8 *imgRight, float32 *dispLeft, float32 *dispRight);
+
+    /** \brief 结束当前视频序列，下一次matchFrame按首帧处理 */
+    void resetSequence();
+
+    /**
+    * \brief 重设，内存池容量足够时复用已分配的内存，否则扩大
     * \param width		输入，核线像对影像宽
     * \param height		输入，核线像对影像高
-    * \param option		输入，SemiGlobalMatching参数
+    * \param option		输入，PatchMatchStereo参数
     */
     bool reset(const uint32 &width, const uint32 &height, const PMSOption &option);
 
+    /**
+    * \brief 计算工作缓冲区所需的内存池字节数
+    * \param width		输入，核线像对影像宽
+    * \param height		输入，核线像对影像高
+    * \param option		输入，PatchMatchStereo参数
+    */
+    static uint64 getMemoryFootprint(const sint32 &width, const sint32 &height, const PMSOption &option);
+
+    /** \brief 获取内存池当前容量字节数 */
+    uint64 getMemoryFootprint() const;
+
+    /** \brief 获取最近一次匹配的传播统计量 */
+    const PMSStatistics &getStatistics() const;
+
+    /** \brief 获取最近一次匹配的各阶段耗时 */
+    const PMSTimings &getTimings() const;
+
+    /** \brief 影像宽 */
+    sint32 getWidth() const;
+
+    /** \brief 影像高 */
+    sint32 getHeight() const;
+
+    /**
+    * \brief 获取最近一次匹配的视差图（后处理之后），数据属于匹配实例，下次匹配或重设前有效
+    * \param view	0为左视图，1为右视图；只计算左视图时右视图返回nullptr
+    */
+    const float32 *getDisparityMap(const sint32 &view) const;
+
+    /**
+    * \brief 获取最近一次匹配的视差平面场，数据属于匹配实例，下次匹配或重设前有效
+    * \param view	0为左视图，1为右视图；只计算左视图时右视图返回nullptr
+    */
+    const DisparityPlane *getDisparityPlanes(const sint32 &view) const;
+
+    /**
+    * \brief 获取最近一次匹配的各像素最优平面的聚合代价，数据属于匹配实例，下次匹配或重设前有效
+    * \param view	0为左视图，1为右视图；只计算左视图时右视图返回nullptr
+    */
+    const float32 *getCostMap(const sint32 &view) const;
+
+    /**
+    * \brief 获取最近一次匹配的灰度图，数据属于匹配实例，下次匹配或重设前有效
+    * \param view	0为左视图，1为右视图；未设置PMSOption::_isKeepGray时返回nullptr
+    */
+    const uint8 *getGrayMap(const sint32 &view) const;
+
 private:
     /** \brief 随机初始化 */
     void randomInitialization();
 
-    /** \brief 计算灰度数据 */
-    void computeGray();
+    /**
+     * \brief 生成随机视差平面
+     * \param x 像素x坐标
+     * \param y 像素y坐标
+     * \param k 视图，0为左视图，1为右视图
+     * \param rng 随机数生成器
+     * \param disp 输出，像素的随机视差
+     */
+    DisparityPlane randomPlane(const sint32 &x, const sint32 &y, const sint32 &k, PMSRandom &rng,
+                               float32 &disp) const;
+
+    /** \brief 视频模式初始化：保存上一帧平面，并以_temporalRandomRatio的比例替换为随机平面 */
+    void temporalInitialization();
 
-    /** \brief 计算梯度数据 */
+    /**
+     * \brief 金字塔初始化：在降采样影像上匹配，并将平面上采样作为本层初值
+     * \return 是否完成初始化；影像过小或粗层匹配失败时返回false，由调用者随机初始化
+     */
+    bool pyramidInitialization();
+
+    /**
+     * \brief 计算梯度数据：左右影像按行带并行，灰度转换与Sobel梯度融合为一遍，需要时输出灰度数据；
+     * 使用Census代价时同一遍内计算Census编码，每次匹配只计算一次，由所有代价计算器共享
+     */
     void computeGradient();
 
+    /** \brief 由影像及梯度构建分平面特征 */
+    void computeFeatures();
+
     /** \brief 迭代传播 */
     void propagation();
 
+    /** \brief 迭代传播，代价计算器类型已在编译期确定 */
+    template<typename CostCpt>
+    void propagationWithCost();
+
+    /** \brief 迭代传播，代价计算器类型及Patch尺寸已在编译期确定（Patch尺寸0表示运行期指定） */
+    template<typename CostCpt, sint32 PatchSize>
+    void propagationWithPatchSize();
+
+    /** \brief 按指定传播策略迭代传播 */
+    template<typename Policy>
+    void runPropagation();
+
     /** \brief 一致性检查	 */
     void lrCheck();
 
+    /** \brief 统计误匹配像素数（左右视图之和） */
+    uint64 countMismatches() const;
+
+    /** \brief 误匹配掩码每行的64位字数，各行按字对齐以便按行并行写入 */
+    sint32 getMismatchWordsPerRow() const {
+        return (_width + 63) / 64;
+    }
+
     /** \brief 视差图填充 */
     void fillHolesInDispMap();
 
+    /**
+     * \brief 平面转换成视差，执行后处理并输出视差图
+     * \param dispLeft 输出，左影像视差图指针
+     * \param dispRight 输出，右影像视差图指针
+     */
+    void outputDisparity(float32 *dispLeft, float32 *dispRight);
+
     /** \brief 平面转换成视差 */
     void planeToDisparity();
 
@@ -80,9 +197,12 @@ private:
     /** \brief 右影像数据	 */
     const uint8 *_imgRight;
 
-    /** \brief 左影像灰度数据	 */
+    /** \brief 内存池，以下工作缓冲区均由其分配	 */
+    PMSArena _arena;
+
+    /** \brief 左影像灰度数据，只在PMSOption::_isKeepGray时分配	 */
     uint8 *_grayLeft;
-    /** \brief 右影像灰度数据	 */
+    /** \brief 右影像灰度数据，只在PMSOption::_isKeepGray时分配	 */
     uint8 *_grayRight;
 
     /** \brief 左影像梯度数据	 */
@@ -90,6 +210,15 @@ private:
     /** \brief 右影像梯度数据	 */
     PGradient *_gradRight;
 
+    /** \brief 左影像Census编码，只在使用Census代价时分配	 */
+    uint64 *_censusLeft;
+    /** \brief 右影像Census编码，只在使用Census代价时分配	 */
+    uint64 *_censusRight;
+
+    /** \brief 左右影像的分平面特征，只在使用PMS代价时分配	 */
+    PMSFeatureImage _featureLeft;
+    PMSFeatureImage _featureRight;
+
     /** \brief 左影像聚合代价数据	 */
     float32 *_costLeft;
     /** \brief 右影像聚合代价数据	 */
@@ -105,12 +234,45 @@ private:
     /** \brief 右影像平面集	*/
     DisparityPlane *_planeRight;
 
+    /** \brief 左右影像支持权值缓存	*/
+    PMSWeightCache _weightCacheLeft;
+    PMSWeightCache _weightCacheRight;
+
+    /** \brief 左右影像整数视差聚合代价体	*/
+    PMSCostVolume _costVolumeLeft;
+    PMSCostVolume _costVolumeRight;
+
+    /** \brief 左右影像的亚像素预插值特征	*/
+    PMSSubpixelImage _subpixelLeft;
+    PMSSubpixelImage _subpixelRight;
+
+    /** \brief 金字塔粗层的左右降采样影像，只在使用金字塔时分配	*/
+    uint8 *_imgCoarseLeft;
+    uint8 *_imgCoarseRight;
+
+    /** \brief 金字塔粗层的匹配实例，各次匹配间复用	*/
+    std::unique_ptr<PatchMatchStereo> _pyramidEngine;
+
+    /** \brief 视频模式：上一帧的左右影像平面集	*/
+    std::vector<DisparityPlane> _planePrevLeft;
+    std::vector<DisparityPlane> _planePrevRight;
+
+    /** \brief 视频模式：当前帧序号，及当前是否为沿用上一帧平面的帧	*/
+    sint32 _frameIndex;
+    bool _isTemporalFrame;
+
+    /** \brief 传播统计量	*/
+    PMSStatistics _statistics;
+
+    /** \brief 各阶段耗时	*/
+    PMSTimings _timings;
+
     /** \brief 是否初始化标志	*/
     bool _isInitialized;
 
-    /** \brief 误匹配区像素集	*/
-    std::vector<std::pair<sint32, sint32>> _mismatchesLeft;
-    std::vector<std::pair<sint32, sint32>> _mismatchesRight;
+    /** \brief 误匹配区像素掩码：每行占 getMismatchWordsPerRow() 个64位字，第x位为1表示像素x为误匹配	*/
+    std::vector<uint64> _mismatchesLeft;
+    std::vector<uint64> _mismatchesRight;
 
 };
 
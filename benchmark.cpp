@@ -0,0 +1,208 @@
+//
+// Created by tianhe on 2022/9/18.
+//
+
+/**
+ * 端到端性能测试：在data目录下的Middlebury像对上执行PatchMatchStereo::match，
+ * 以JSON格式输出各阶段耗时、吞吐量及内存峰值，便于在不同参数组合间比较。
+ *
+ * 用法: PatchMatchBenchmark [--data 目录] [--patch N] [--iters N] [--fpw] [--integer-disp] [--cost-volume]
+ *                            [--lr] [--fill] [--threads N] [--checkerboard] [--pyramid N] [--no-simd] [--census]
+ *                            [--subpixel N] [--repeat N]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "PMSType.h"
+#include "PMSBatch.h"
+#include "PMSImageUtil.h"
+#include "PatchMatchStereo.h"
+
+/** \brief 进程内存峰值（字节） */
+static uint64 peakMemoryBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return uint64(pmc.PeakWorkingSetSize);
+    }
+    return 0;
+#else
+    struct rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return uint64(usage.ru_maxrss);
+#else
+    return uint64(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+int main(int argc, char **argv) {
+    // ··· 参数
+    std::string dataDir = "../data";
+    sint32 repeat = 1;
+    PMSOption option;
+    option._patchSize = 35;
+    option._numIters = 3;
+    option._isCheckLR = false;
+    option._lrCheckThres = 1.0f;
+    option._isFillHoles = false;
+    option._isForceFpw = false;
+    option._numThreads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--data" && hasValue) {
+            dataDir = argv[++i];
+        } else if (arg == "--patch" && hasValue) {
+            option._patchSize = std::atoi(argv[++i]);
+        } else if (arg == "--iters" && hasValue) {
+            option._numIters = std::atoi(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            option._numThreads = std::atoi(argv[++i]);
+        } else if (arg == "--pyramid" && hasValue) {
+            option._numPyramidLevels = std::atoi(argv[++i]);
+        } else if (arg == "--repeat" && hasValue) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--fpw") {
+            option._isForceFpw = true;
+        } else if (arg == "--integer-disp") {
+            option._isIntegerDisp = true;
+        } else if (arg == "--cost-volume") {
+            option._isUseCostVolume = true;
+        } else if (arg == "--lr") {
+            option._isCheckLR = true;
+        } else if (arg == "--fill") {
+            option._isFillHoles = true;
+        } else if (arg == "--checkerboard") {
+            option._isCheckerboard = true;
+        } else if (arg == "--no-simd") {
+            option._isUseSimd = false;
+        } else if (arg == "--census") {
+            option._costType = PMS_COST_CENSUS;
+        } else if (arg == "--subpixel" && hasValue) {
+            option._subpixelStep = std::atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "unknown argument: %s\n", arg.c_str());
+            return -1;
+        }
+    }
+
+    // ··· 数据集：名称、左影像、右影像
+    const std::vector<std::vector<std::string>> dataSets = {
+            {"Cone", "im2.png", "im6.png"},
+            {"Piano", "im0.png", "im1.png"},
+            {"Reindeer", "view1.png", "view5.png"}
+    };
+
+    printf("{\n");
+    printf("  \"options\": {\"patch_size\": %d, \"iterations\": %d, \"force_fpw\": %s, \"integer_disp\": %s, "
+           "\"cost_volume\": %s, \"lr_check\": %s, "
+           "\"fill_holes\": %s, \"checkerboard\": %s, \"threads\": %d, \"pyramid_levels\": %d, \"simd\": %s, "
+           "\"cost\": \"%s\", \"subpixel_step\": %d, \"repeat\": %d},\n",
+           option._patchSize, option._numIters, option._isForceFpw ? "true" : "false",
+           option._isIntegerDisp ? "true" : "false", option._isUseCostVolume ? "true" : "false",
+           option._isCheckLR ? "true" : "false", option._isFillHoles ? "true" : "false",
+           option._isCheckerboard ? "true" : "false", option._numThreads, option._numPyramidLevels,
+           option._isUseSimd ? "true" : "false", option._costType == PMS_COST_CENSUS ? "census" : "pms",
+           option._subpixelStep, repeat);
+    printf("  \"datasets\": [");
+
+    bool isFirst = true;
+    for (const auto &dataSet: dataSets) {
+        const std::string dir = dataDir + "/" + dataSet[0];
+        std::vector<uint8> bytesLeft, bytesRight;
+        sint32 width = 0, height = 0, widthRight = 0, heightRight = 0;
+        if (!loadImage(dir + "/" + dataSet[1], bytesLeft, width, height) ||
+            !loadImage(dir + "/" + dataSet[2], bytesRight, widthRight, heightRight) ||
+            width != widthRight || height != heightRight) {
+            fprintf(stderr, "failed to read images: %s\n", dir.c_str());
+            continue;
+        }
+        PMSOption optionPair = option;
+        if (!PMSBatchMatcher::loadDisparityRange(dir + "/d_range.txt",
+                                                 optionPair._minDisparity, optionPair._maxDisparity)) {
+            fprintf(stderr, "failed to read disparity range: %s\n", dir.c_str());
+            continue;
+        }
+
+        PatchMatchStereo pms;
+        if (!pms.initialize(width, height, optionPair)) {
+            fprintf(stderr, "initialization failed: %s\n", dir.c_str());
+            continue;
+        }
+
+        // 多次运行取总耗时最短的一次
+        std::vector<float32> dispLeft(size_t(width) * height), dispRight(size_t(width) * height);
+        PMSTimings best;
+        PMSStatistics stats;
+        bool isSuccess = true;
+        for (sint32 r = 0; r < repeat && isSuccess; r++) {
+            isSuccess = pms.match(bytesLeft.data(), bytesRight.data(), dispLeft.data(), dispRight.data());
+            if (r == 0 || pms.getTimings()._total < best._total) {
+                best = pms.getTimings();
+                stats = pms.getStatistics();
+            }
+        }
+        if (!isSuccess) {
+            fprintf(stderr, "matching failed: %s\n", dir.c_str());
+            continue;
+        }
+
+        const float64 megaPixels = float64(width) * float64(height) / 1e6;
+        const float64 seconds = best._total / 1000.0;
+        const sint32 numDisparities = optionPair._maxDisparity - optionPair._minDisparity;
+
+        printf("%s\n    {\"name\": \"%s\", \"width\": %d, \"height\": %d, \"min_disparity\": %d, \"max_disparity\": %d,\n",
+               isFirst ? "" : ",", dataSet[0].c_str(), width, height,
+               optionPair._minDisparity, optionPair._maxDisparity);
+        printf("     \"stages_ms\": {\"initialization\": %.3f, \"gradient\": %.3f, \"features\": %.3f, "
+               "\"pyramid\": %.3f, \"propagation\": %.3f, \"plane_to_disparity\": %.3f, \"lr_check\": %.3f, "
+               "\"fill_holes\": %.3f},\n",
+               best._initialization, best._computeGradient, best._computeFeatures, best._pyramid,
+               best._propagation, best._planeToDisparity, best._lrCheck, best._fillHoles);
+        printf("     \"total_ms\": %.3f, \"mpixels_per_sec\": %.4f, \"mpixel_disparities_per_sec\": %.4f,\n",
+               best._total, megaPixels / seconds, megaPixels * numDisparities / seconds);
+        printf("     \"iterations_ms\": [");
+        for (size_t k = 0; k < best._iterations.size(); k++) {
+            printf("%s%.3f", k == 0 ? "" : ", ", best._iterations[k]);
+        }
+        printf("],\n");
+        printf("     \"counters\": {\"evaluations\": %llu, \"pruned\": %llu, \"processed\": %llu, "
+               "\"spatial_accepted\": %llu, \"spatial_rejected\": %llu, "
+               "\"refine_accepted\": %llu, \"refine_rejected\": %llu, \"refine_out_of_range\": %llu, "
+               "\"view_accepted\": %llu, \"view_rejected\": %llu, \"lr_mismatches\": %llu},\n",
+               (unsigned long long) stats._numEvaluations, (unsigned long long) stats._numPruned,
+               (unsigned long long) stats._numProcessed,
+               (unsigned long long) stats._numSpatialAccepted, (unsigned long long) stats._numSpatialRejected,
+               (unsigned long long) stats._numRefineAccepted, (unsigned long long) stats._numRefineRejected,
+               (unsigned long long) stats._numRefineOutOfRange,
+               (unsigned long long) stats._numViewAccepted, (unsigned long long) stats._numViewRejected,
+               (unsigned long long) stats._numLRMismatches);
+        printf("     \"arena_bytes\": %llu}", (unsigned long long) pms.getMemoryFootprint());
+        isFirst = false;
+    }
+
+    printf("\n  ],\n");
+    printf("  \"peak_memory_bytes\": %llu\n", (unsigned long long) peakMemoryBytes());
+    printf("}\n");
+
+    return 0;
+}
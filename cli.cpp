@@ -0,0 +1,605 @@
+//
+// Created by tianhe on 2022/9/19.
+//
+
+/**
+ * 无界面命令行工具：批量匹配核线像对，输出浮点视差图，不弹出任何窗口。
+ *
+ * 输入可以是：
+ *   - 数据集目录：目录下含d_range.txt及一对已知命名的影像（im2/im6、im0/im1、view1/view5、left/right）；
+ *     若目录本身不是数据集，则递归查找其中所有含d_range.txt的子目录
+ *   - --pair 左影像 右影像：视差范围取左影像所在目录的d_range.txt，不存在时取--min-disp/--max-disp
+ * 影像可以是常规图像文件，也可以是3通道uint8的.pmsraw文件（以内存映射方式读取，不复制）。
+ * 指定--tile时按分块匹配（PMSTiledMatcher），适用于超出内存的大幅影像，各像对依次处理，分块并行。
+ *
+ * 每个像对输出 <名称>_left 及 <名称>_right 视差图（32位浮点，无效视差为inf），格式为PFM、
+ * 带文件头的原始数据（.pmsraw，可内存映射）或TIFF；可选输出平面场及聚合代价。
+ * 多个像对由PMSBatchMatcher并行处理，输出直接在工作线程中由匹配实例的缓冲区写出。
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "PMSType.h"
+#include "PMSBatch.h"
+#include "PMSIO.h"
+#include "PMSImageUtil.h"
+#include "PMSTiled.h"
+#include "PatchMatchStereo.h"
+
+/** \brief 数据集目录中可识别的左右影像文件名 */
+static const char *PAIR_NAMES[][2] = {
+        {"im2.png",   "im6.png"},
+        {"im0.png",   "im1.png"},
+        {"view1.png", "view5.png"},
+        {"left.png",  "right.png"},
+        {"left.pmsraw", "right.pmsraw"}
+};
+
+/** \brief 内存映射输入的文件扩展名 */
+static const char *MAPPED_EXTENSION = ".pmsraw";
+
+/** \brief 视差范围文件名 */
+static const char *DISPARITY_RANGE_FILE = "d_range.txt";
+
+/** \brief 输出文件格式 */
+enum class OutputFormat {
+    PFM,
+    RAW,
+    TIFF
+};
+
+/** \brief 输出参数 */
+struct OutputOption {
+    std::string _dir;               // 输出目录
+    OutputFormat _format;           // 文件格式
+    bool _isPreview;                // 是否输出8位预览图
+    bool _isWritePlanes;            // 是否输出平面场
+    bool _isWriteCost;              // 是否输出聚合代价
+
+    OutputOption() : _dir("."), _format(OutputFormat::PFM), _isPreview(false),
+                     _isWritePlanes(false), _isWriteCost(false) {}
+};
+
+/** \brief 一个待匹配的像对 */
+struct PairTask {
+    std::string _name;          // 输出文件名前缀
+    std::string _pathLeft;      // 左影像路径
+    std::string _pathRight;     // 右影像路径
+    std::string _pathRange;     // 视差范围文件路径，为空时使用命令行参数
+};
+
+static void printUsage() {
+    printf("usage: PatchMatchCli [options] <dataset dir>... [--pair <left> <right>]...\n"
+           "\n"
+           "input/output:\n"
+           "  --pair L R                 match an explicit image pair (repeatable)\n"
+           "  --out DIR                  output directory (default: .)\n"
+           "  --format pfm|raw|tiff      float output format (default: pfm)\n"
+           "  --planes                   also write the plane field (a, b, c per pixel)\n"
+           "  --cost                     also write the aggregated cost of the best planes\n"
+           "  --jobs N                   pairs matched in parallel (default: hardware threads)\n"
+           "  --preview                  also write 8-bit normalized PNG previews\n"
+           "  --tile N                   match each pair in overlapping N x N tiles (disparity output only)\n"
+           "\n"
+           "matching options (PMSOption):\n"
+           "  --patch N                  patch size (odd)\n"
+           "  --min-disp N, --max-disp N disparity range when no d_range.txt is found\n"
+           "  --gamma F, --alpha F, --tau-col F, --tau-grad F\n"
+           "  --cost-type pms|census     matching cost\n"
+           "  --iters N                  propagation iterations\n"
+           "  --left-only                compute the left view only\n"
+           "  --lr / --no-lr             left-right consistency check\n"
+           "  --lr-thres F               consistency threshold\n"
+           "  --fill / --no-fill         hole filling\n"
+           "  --fpw                      force fronto-parallel windows\n"
+           "  --integer-disp             integer disparity precision\n"
+           "  --cost-volume              precomputed cost volume (with --fpw --integer-disp)\n"
+           "  --pyramid N                pyramid levels\n"
+           "  --coarse-iters N           iterations on coarse levels\n"
+           "  --checkerboard / --no-checkerboard\n"
+           "  --threads N                threads per pair (default: hardware threads / jobs)\n"
+           "  --simd / --no-simd         SIMD aggregation kernels\n"
+           "  --seed N                   random seed\n"
+           "  --weight-cache             cache support weights\n"
+           "  --weight-cache-thres F     weight cache threshold\n"
+           "  --subpixel-step N          pre-interpolated sub-pixel step (4, 8, 16; 0 = exact)\n"
+           "  --active-set               active set propagation\n"
+           "  --active-set-thres F       early stop threshold on the active ratio\n"
+           "  --temporal-random-ratio F  video mode random re-initialization ratio\n"
+           "  --temporal-iters N         video mode iterations\n");
+}
+
+/** \brief 文件是否存在 */
+static bool isFileExists(const std::string &path) {
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        return false;
+    }
+    fclose(fp);
+    return true;
+}
+
+/** \brief 去掉路径末尾的分隔符 */
+static std::string trimSeparator(std::string path) {
+    while (path.size() > 1 && (path.back() == '/' || path.back() == '\\')) {
+        path.pop_back();
+    }
+    return path;
+}
+
+/** \brief 路径的目录部分，无目录时返回"." */
+static std::string dirName(const std::string &path) {
+    const auto pos = path.find_last_of("/\\");
+    return pos == std::string::npos ? std::string(".") : path.substr(0, pos);
+}
+
+/** \brief 路径的文件名部分 */
+static std::string baseName(const std::string &path) {
+    const auto pos = path.find_last_of("/\\");
+    return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+/** \brief 去掉文件扩展名 */
+static std::string stemName(const std::string &path) {
+    const std::string name = baseName(path);
+    const auto pos = name.find_last_of('.');
+    return pos == std::string::npos ? name : name.substr(0, pos);
+}
+
+/** \brief 将相对路径转换为输出文件名前缀：路径分隔符替换为下划线 */
+static std::string flattenPath(std::string path) {
+    std::replace(path.begin(), path.end(), '/', '_');
+    std::replace(path.begin(), path.end(), '\\', '_');
+    return path;
+}
+
+/**
+ * \brief 显式像对的输出文件名前缀：所在目录名加左影像文件名（不含扩展名），
+ * 以区分不同数据集下同名的影像（如im2.png）
+ */
+static std::string pairName(const std::string &pathLeft) {
+    const std::string parent = baseName(trimSeparator(dirName(pathLeft)));
+    const std::string stem = stemName(pathLeft);
+    return (parent.empty() || parent == "." || parent == "..") ? stem : parent + "_" + stem;
+}
+
+/**
+ * \brief 将数据集目录解析为像对
+ * \param dir 数据集目录
+ * \param name 输出文件名前缀
+ * \param task 输出，像对
+ * \return 目录下是否含视差范围文件及可识别的影像对
+ */
+static bool parseDataSet(const std::string &dir, const std::string &name, PairTask &task) {
+    const std::string pathRange = dir + "/" + DISPARITY_RANGE_FILE;
+    if (!isFileExists(pathRange)) {
+        return false;
+    }
+    for (const auto &names: PAIR_NAMES) {
+        const std::string pathLeft = dir + "/" + names[0];
+        const std::string pathRight = dir + "/" + names[1];
+        if (isFileExists(pathLeft) && isFileExists(pathRight)) {
+            task._name = name;
+            task._pathLeft = pathLeft;
+            task._pathRight = pathRight;
+            task._pathRange = pathRange;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * \brief 收集目录下的所有像对：目录本身是数据集时只取该目录，否则递归查找所有数据集子目录
+ * \param dir 目录
+ * \param tasks 输出，追加像对
+ * \return 找到的像对数
+ */
+static sint32 collectDataSets(const std::string &dir, std::vector<PairTask> &tasks) {
+    PairTask task;
+    if (parseDataSet(dir, baseName(dir), task)) {
+        tasks.push_back(task);
+        return 1;
+    }
+
+    std::vector<cv::String> files;
+    cv::glob(dir + "/" + DISPARITY_RANGE_FILE, files, true);
+    std::sort(files.begin(), files.end());
+    sint32 num = 0;
+    for (const auto &file: files) {
+        // 以相对输入目录的路径命名，嵌套数据集中的同名子目录（如2005/Art与2006/Art）不会冲突
+        const std::string dataDir = dirName(file);
+        const bool isUnderRoot = dataDir.size() > dir.size() + 1 && dataDir.compare(0, dir.size(), dir) == 0;
+        const std::string name = flattenPath(isUnderRoot ? dataDir.substr(dir.size() + 1) : dataDir);
+        if (parseDataSet(dataDir, name, task)) {
+            tasks.push_back(task);
+            num++;
+        }
+    }
+    return num;
+}
+
+/** \brief 输出文件名前缀仍重复时（如多个输入目录含同名数据集）依次追加序号，避免结果互相覆盖 */
+static void makeUniqueNames(std::vector<PairTask> &tasks) {
+    std::set<std::string> names;
+    for (auto &task: tasks) {
+        std::string name = task._name;
+        for (sint32 index = 2; !names.insert(name).second; index++) {
+            name = task._name + "_" + std::to_string(index);
+        }
+        if (name != task._name) {
+            fprintf(stderr, "duplicate output name %s, renamed to %s\n", task._name.c_str(), name.c_str());
+            task._name = name;
+        }
+    }
+}
+
+struct InputImage {
+    std::vector<uint8> _bytes;      // 解码后的3通道数据
+    PMSMappedFile _mapped;          // 内存映射的文件
+    sint32 _width;                  // 影像宽
+    sint32 _height;                 // 影像高
+
+    InputImage() : _width(0), _height(0) {}
+
+    /** \brief 读取影像 */
+    bool load(const std::string &path) {
+        const std::string ext = MAPPED_EXTENSION;
+        if (path.size() > ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0) {
+            if (!_mapped.open(path)) {
+                return false;
+            }
+            const auto &header = _mapped.getHeader();
+            _width = sint32(header._width);
+            _height = sint32(header._height);
+            return header._channels == 3 && header._dataType == PMS_RAW_UINT8;
+        }
+        return loadImage(path, _bytes, _width, _height);
+    }
+
+    /** \brief 3通道影像数据 */
+    const uint8 *getData() const {
+        return _mapped.getData() != nullptr ? _mapped.getData() : _bytes.data();
+    }
+};
+
+/**
+ * \brief 读取像对的影像及视差范围
+ * \param task 像对
+ * \param option 匹配参数，无视差范围文件时取其视差范围
+ * \param imgLeft 输出，左影像
+ * \param imgRight 输出，右影像
+ * \param item 输出，匹配任务
+ * \return 是否成功
+ */
+static bool loadPair(const PairTask &task, const PMSOption &option, InputImage &imgLeft, InputImage &imgRight,
+                     PMSBatchItem &item) {
+    if (!imgLeft.load(task._pathLeft) || !imgRight.load(task._pathRight)) {
+        fprintf(stderr, "failed to read images: %s\n", task._name.c_str());
+        return false;
+    }
+    if (imgLeft._width != imgRight._width || imgLeft._height != imgRight._height) {
+        fprintf(stderr, "image size is inconsistent: %s\n", task._name.c_str());
+        return false;
+    }
+    item._width = imgLeft._width;
+    item._height = imgLeft._height;
+    item._minDisparity = option._minDisparity;
+    item._maxDisparity = option._maxDisparity;
+    if (!task._pathRange.empty() &&
+        !PMSBatchMatcher::loadDisparityRange(task._pathRange, item._minDisparity, item._maxDisparity)) {
+        fprintf(stderr, "failed to read disparity range: %s\n", task._pathRange.c_str());
+        return false;
+    }
+    item._imgLeft = imgLeft.getData();
+    item._imgRight = imgRight.getData();
+    return true;
+}
+
+/** \brief 按输出格式写出单通道浮点数据 */
+static bool writeFloat(const std::string &path, const float32 *data, const sint32 &width, const sint32 &height,
+                       const OutputFormat &format) {
+    switch (format) {
+        case OutputFormat::PFM:
+            return writePfm(path + ".pfm", data, width, height, 1);
+        case OutputFormat::RAW:
+            return writeRaw(path + ".pmsraw", data, width, height, 1, PMS_RAW_FLOAT32);
+        default: {
+            // 直接以实例缓冲区构造影像头，不复制数据
+            const cv::Mat mat(height, width, CV_32FC1, const_cast<float32 *>(data));
+            return cv::imwrite(path + ".tiff", mat);
+        }
+    }
+}
+
+/**
+ * \brief 写出一个视图的匹配结果
+ * \param prefix 输出文件名前缀
+ * \param engine 完成匹配的实例
+ * \param view 0为左视图，1为右视图
+ * \param output 输出参数
+ * \return 是否成功
+ */
+static bool writeView(const std::string &prefix, const PatchMatchStereo &engine, const sint32 &view,
+                      const OutputOption &output) {
+    const sint32 width = engine.getWidth();
+    const sint32 height = engine.getHeight();
+    const float32 *disp = engine.getDisparityMap(view);
+    if (!writeFloat(prefix, disp, width, height, output._format)) {
+        return false;
+    }
+    if (output._isWritePlanes) {
+        // 平面场为3通道，TIFF格式下改用PFM
+        const DisparityPlane *planes = engine.getDisparityPlanes(view);
+        const bool isSuccess = output._format == OutputFormat::RAW ?
+                               writePlanesRaw(prefix + "_planes.pmsraw", planes, width, height) :
+                               writePlanesPfm(prefix + "_planes.pfm", planes, width, height);
+        if (!isSuccess) {
+            return false;
+        }
+    }
+    if (output._isWriteCost && !writeFloat(prefix + "_cost", engine.getCostMap(view), width, height,
+                                           output._format)) {
+        return false;
+    }
+    if (output._isPreview) {
+        cv::Mat previewMat(height, width, CV_8UC1);
+        dispMatNorm(width, height, disp, previewMat);
+        return cv::imwrite(prefix + ".png", previewMat);
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    // ··· 参数
+    std::vector<PairTask> tasks;
+    OutputOption output;
+    sint32 numJobs = 0;
+    sint32 tileSize = 0;
+
+    PMSOption option;
+    option._patchSize = 35;
+    option._minDisparity = 0;
+    option._maxDisparity = 64;
+    option._numIters = 3;
+    option._isCheckLR = true;
+    option._lrCheckThres = 1.0f;
+    option._isFillHoles = true;
+    option._isCheckerboard = true;
+    option._numThreads = 0;
+
+    if (argc < 2) {
+        printUsage();
+        return -1;
+    }
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else if (arg == "--pair" && i + 2 < argc) {
+            PairTask task;
+            task._pathLeft = argv[++i];
+            task._pathRight = argv[++i];
+            task._name = pairName(task._pathLeft);
+            const std::string pathRange = dirName(task._pathLeft) + "/" + DISPARITY_RANGE_FILE;
+            if (isFileExists(pathRange)) {
+                task._pathRange = pathRange;
+            }
+            tasks.push_back(task);
+        } else if (arg == "--out" && hasValue) {
+            output._dir = trimSeparator(argv[++i]);
+        } else if (arg == "--format" && hasValue) {
+            const std::string format = argv[++i];
+            if (format == "pfm") {
+                output._format = OutputFormat::PFM;
+            } else if (format == "raw") {
+                output._format = OutputFormat::RAW;
+            } else if (format == "tiff") {
+                output._format = OutputFormat::TIFF;
+            } else {
+                fprintf(stderr, "unknown format: %s\n", format.c_str());
+                return -1;
+            }
+        } else if (arg == "--planes") {
+            output._isWritePlanes = true;
+        } else if (arg == "--cost") {
+            output._isWriteCost = true;
+        } else if (arg == "--jobs" && hasValue) {
+            numJobs = std::atoi(argv[++i]);
+        } else if (arg == "--tile" && hasValue) {
+            tileSize = std::atoi(argv[++i]);
+        } else if (arg == "--preview") {
+            output._isPreview = true;
+        } else if (arg == "--patch" && hasValue) {
+            option._patchSize = std::atoi(argv[++i]);
+        } else if (arg == "--min-disp" && hasValue) {
+            option._minDisparity = std::atoi(argv[++i]);
+        } else if (arg == "--max-disp" && hasValue) {
+            option._maxDisparity = std::atoi(argv[++i]);
+        } else if (arg == "--gamma" && hasValue) {
+            option._gamma = float32(std::atof(argv[++i]));
+        } else if (arg == "--alpha" && hasValue) {
+            option._alpha = float32(std::atof(argv[++i]));
+        } else if (arg == "--tau-col" && hasValue) {
+            option._tauCol = float32(std::atof(argv[++i]));
+        } else if (arg == "--tau-grad" && hasValue) {
+            option._tauGrad = float32(std::atof(argv[++i]));
+        } else if (arg == "--cost-type" && hasValue) {
+            const std::string type = argv[++i];
+            if (type == "pms") {
+                option._costType = PMS_COST_PMS;
+            } else if (type == "census") {
+                option._costType = PMS_COST_CENSUS;
+            } else {
+                fprintf(stderr, "unknown cost type: %s\n", type.c_str());
+                return -1;
+            }
+        } else if (arg == "--iters" && hasValue) {
+            option._numIters = std::atoi(argv[++i]);
+        } else if (arg == "--left-only") {
+            option._isLeftOnly = true;
+        } else if (arg == "--lr") {
+            option._isCheckLR = true;
+        } else if (arg == "--no-lr") {
+            option._isCheckLR = false;
+        } else if (arg == "--lr-thres" && hasValue) {
+            option._lrCheckThres = float32(std::atof(argv[++i]));
+        } else if (arg == "--fill") {
+            option._isFillHoles = true;
+        } else if (arg == "--no-fill") {
+            option._isFillHoles = false;
+        } else if (arg == "--fpw") {
+            option._isForceFpw = true;
+        } else if (arg == "--integer-disp") {
+            option._isIntegerDisp = true;
+        } else if (arg == "--cost-volume") {
+            option._isUseCostVolume = true;
+        } else if (arg == "--pyramid" && hasValue) {
+            option._numPyramidLevels = std::atoi(argv[++i]);
+        } else if (arg == "--coarse-iters" && hasValue) {
+            option._numCoarseIters = std::atoi(argv[++i]);
+        } else if (arg == "--checkerboard") {
+            option._isCheckerboard = true;
+        } else if (arg == "--no-checkerboard") {
+            option._isCheckerboard = false;
+        } else if (arg == "--threads" && hasValue) {
+            option._numThreads = std::atoi(argv[++i]);
+        } else if (arg == "--simd") {
+            option._isUseSimd = true;
+        } else if (arg == "--no-simd") {
+            option._isUseSimd = false;
+        } else if (arg == "--seed" && hasValue) {
+            option._seed = uint64(std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--weight-cache") {
+            option._isUseWeightCache = true;
+        } else if (arg == "--weight-cache-thres" && hasValue) {
+            option._weightCacheThres = float32(std::atof(argv[++i]));
+        } else if (arg == "--subpixel-step" && hasValue) {
+            option._subpixelStep = std::atoi(argv[++i]);
+        } else if (arg == "--active-set") {
+            option._isUseActiveSet = true;
+        } else if (arg == "--active-set-thres" && hasValue) {
+            option._activeSetThres = float32(std::atof(argv[++i]));
+        } else if (arg == "--temporal-random-ratio" && hasValue) {
+            option._temporalRandomRatio = float32(std::atof(argv[++i]));
+        } else if (arg == "--temporal-iters" && hasValue) {
+            option._numTemporalIters = std::atoi(argv[++i]);
+        } else if (!arg.empty() && arg[0] != '-') {
+            const std::string dir = trimSeparator(arg);
+            if (collectDataSets(dir, tasks) == 0) {
+                fprintf(stderr, "no dataset found: %s\n", dir.c_str());
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "unknown argument: %s\n", arg.c_str());
+            printUsage();
+            return -1;
+        }
+    }
+    if (tasks.empty()) {
+        fprintf(stderr, "no input\n");
+        return -1;
+    }
+    makeUniqueNames(tasks);
+
+    // ··· 分块匹配：各像对依次处理，分块并行
+    sint32 numFailed = 0;
+    if (tileSize > 0) {
+        if (output._isWritePlanes || output._isWriteCost) {
+            fprintf(stderr, "--planes and --cost are ignored in tiled mode\n");
+        }
+        // 各像对共用一个分块匹配器，只按视差范围重设
+        PMSTiledMatcher matcher(option, tileSize, numJobs);
+        for (const auto &task: tasks) {
+            InputImage imgLeft, imgRight;
+            PMSBatchItem item;
+            if (!loadPair(task, option, imgLeft, imgRight, item)) {
+                numFailed++;
+                continue;
+            }
+            PMSOption optionPair = option;
+            optionPair._minDisparity = item._minDisparity;
+            optionPair._maxDisparity = item._maxDisparity;
+            if (!matcher.reset(optionPair)) {
+                fprintf(stderr, "matching failed: %s\n", task._name.c_str());
+                numFailed++;
+                continue;
+            }
+
+            const size_t size = size_t(item._width) * size_t(item._height);
+            std::vector<float32> dispLeft(size), dispRight(optionPair._isLeftOnly ? 0 : size);
+            if (!matcher.match(item._imgLeft, item._imgRight, item._width, item._height, dispLeft.data(),
+                               dispRight.empty() ? nullptr : dispRight.data())) {
+                fprintf(stderr, "matching failed: %s\n", task._name.c_str());
+                numFailed++;
+                continue;
+            }
+
+            const std::string prefix = output._dir + "/" + task._name;
+            bool isSuccess = writeFloat(prefix + "_left", dispLeft.data(), item._width, item._height, output._format);
+            if (!dispRight.empty()) {
+                isSuccess = writeFloat(prefix + "_right", dispRight.data(), item._width, item._height,
+                                       output._format) && isSuccess;
+            }
+            if (!isSuccess) {
+                fprintf(stderr, "failed to write outputs: %s\n", task._name.c_str());
+                numFailed++;
+                continue;
+            }
+            printf("%s: %dx%d, disparity [%d, %d], %d tiles\n", task._name.c_str(), item._width, item._height,
+                   item._minDisparity, item._maxDisparity, sint32(matcher.makeTiles(item._width, item._height).size()));
+        }
+        return numFailed == 0 ? 0 : -2;
+    }
+
+    // ··· 流式批量匹配：各工作线程自行读取下一个像对，读取、匹配及写出在线程间重叠；
+    // 每个线程只保留当前像对的影像，同时驻留内存的影像数等于匹配实例数
+    PMSBatchMatcher matcher(option, numJobs);
+    std::vector<InputImage> imgLeft(matcher.getNumEngines()), imgRight(matcher.getNumEngines());
+    std::vector<PMSBatchItem> items(tasks.size());
+    std::vector<uint8> isLoaded(tasks.size(), 0), isWritten(tasks.size(), 0);
+    const auto results = matcher.match(sint32(tasks.size()),
+                                       [&](const sint32 &index, const sint32 &tid, PMSBatchItem &item) {
+        isLoaded[index] = loadPair(tasks[index], option, imgLeft[tid], imgRight[tid], item) ? 1 : 0;
+        items[index] = item;
+        return isLoaded[index] != 0;
+    }, [&](const sint32 &index, const PatchMatchStereo &engine) {
+        // 在工作线程中直接由实例缓冲区写出结果
+        const std::string prefix = output._dir + "/" + tasks[index]._name;
+        bool isSuccess = writeView(prefix + "_left", engine, 0, output);
+        if (engine.getDisparityMap(1) != nullptr) {
+            isSuccess = writeView(prefix + "_right", engine, 1, output) && isSuccess;
+        }
+        isWritten[index] = isSuccess ? 1 : 0;
+    });
+
+    for (size_t n = 0; n < tasks.size(); n++) {
+        const auto &task = tasks[n];
+        const auto &item = items[n];
+        if (!isLoaded[n] || !results[n]._isSuccess) {
+            if (isLoaded[n]) {
+                fprintf(stderr, "matching failed: %s\n", task._name.c_str());
+            }
+            numFailed++;
+            continue;
+        }
+        if (!isWritten[n]) {
+            fprintf(stderr, "failed to write outputs: %s\n", task._name.c_str());
+            numFailed++;
+            continue;
+        }
+        printf("%s: %dx%d, disparity [%d, %d]\n", task._name.c_str(), item._width, item._height,
+               item._minDisparity, item._maxDisparity);
+    }
+
+    return numFailed == 0 ? 0 : -2;
+}
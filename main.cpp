@@ -1,63 +1,42 @@
 #include "PMSType.h"
 #include "PatchMatchStereo.h"
+#include "PMSBatch.h"
+#include "PMSIO.h"
+#include "PMSImageUtil.h"
 #include <opencv2/opencv.hpp>
 
-void dispMatNorm(const sint32 &width, const sint32 &height, const float32 *dispMap, cv::Mat &dispMat) {
-    float32 minDisparity = FLT_MAX, maxDisparity = FLT_MIN;
-    for (sint32 i = 0; i < height; i++) {
-        for (sint32 j = 0; j < width; j++) {
-            const float32 disp = std::abs(dispMap[i * width + j]);
-            if (disp != Invalid_Float) {
-                minDisparity = std::min(minDisparity, disp);
-                maxDisparity = std::max(maxDisparity, disp);
-            }
-        }
-    }
-    for (uint32 i = 0; i < height; i++) {
-        for (uint32 j = 0; j < width; j++) {
-            const float32 disp = std::abs(dispMap[i * width + j]);
-            if (disp == Invalid_Float) {
-                dispMat.data[i * width + j] = 0;
-            } else {
-                dispMat.data[i * width + j] = static_cast<uchar>((disp - minDisparity) / (maxDisparity - minDisparity) *
-                                                                 255);
-            }
-        }
-    }
-}
-
 int main() {
-    // ··· 读取影像
-    std::string pathLeft = R"(..\data\cone\im2.png)";
-    std::string pathRight = R"(..\data\cone\im6.png)";
+    // ··· 数据集：名称、左影像、右影像，目录为../data/名称
+    const std::vector<std::vector<std::string>> dataSets = {
+            {"Cone", "im2.png", "im6.png"},
+            {"Piano", "im0.png", "im1.png"},
+            {"Reindeer", "view1.png", "view5.png"}
+    };
 
-    cv::Mat imgLeft = cv::imread(pathLeft, cv::IMREAD_COLOR);
-    cv::Mat imgRight = cv::imread(pathRight, cv::IMREAD_COLOR);
-
-    if (imgLeft.data == nullptr || imgRight.data == nullptr) {
-        std::cout << "Read Image Failed!" << std::endl;
-        return -1;
-    }
-    if (imgLeft.rows != imgRight.rows || imgLeft.cols != imgRight.cols) {
-        std::cout << "Image Size is Inconsistent!" << std::endl;
-        return -1;
-    }
-
-    // ··· SGM匹配
-    const auto width = static_cast<sint32>(imgLeft.cols);
-    const auto height = static_cast<sint32>(imgRight.rows);
+    // ··· 读取影像及视差范围
+    std::vector<std::vector<uint8>> bytesLeft(dataSets.size()), bytesRight(dataSets.size());
+    std::vector<PMSBatchItem> items(dataSets.size());
+    for (size_t n = 0; n < dataSets.size(); n++) {
+        const std::string dir = "../data/" + dataSets[n][0];
+        sint32 widthLeft, heightLeft, widthRight, heightRight;
+        if (!loadImage(dir + "/" + dataSets[n][1], bytesLeft[n], widthLeft, heightLeft) ||
+            !loadImage(dir + "/" + dataSets[n][2], bytesRight[n], widthRight, heightRight)) {
+            std::cout << "Read Image Failed: " << dir << std::endl;
+            return -1;
+        }
+        if (widthLeft != widthRight || heightLeft != heightRight) {
+            std::cout << "Image Size is Inconsistent: " << dir << std::endl;
+            return -1;
+        }
 
-    // 左右影像的彩色数据
-    auto bytesLeft = new uint8[width * height * 3];
-    auto bytesRight = new uint8[width * height * 3];
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            bytesLeft[i * 3 * width + 3 * j] = imgLeft.at<cv::Vec3b>(i, j)[0];
-            bytesLeft[i * 3 * width + 3 * j + 1] = imgLeft.at<cv::Vec3b>(i, j)[1];
-            bytesLeft[i * 3 * width + 3 * j + 2] = imgLeft.at<cv::Vec3b>(i, j)[2];
-            bytesRight[i * 3 * width + 3 * j] = imgRight.at<cv::Vec3b>(i, j)[0];
-            bytesRight[i * 3 * width + 3 * j + 1] = imgRight.at<cv::Vec3b>(i, j)[1];
-            bytesRight[i * 3 * width + 3 * j + 2] = imgRight.at<cv::Vec3b>(i, j)[2];
+        auto &item = items[n];
+        item._imgLeft = bytesLeft[n].data();
+        item._imgRight = bytesRight[n].data();
+        item._width = widthLeft;
+        item._height = heightLeft;
+        if (!PMSBatchMatcher::loadDisparityRange(dir + "/d_range.txt", item._minDisparity, item._maxDisparity)) {
+            std::cout << "Read Disparity Range Failed: " << dir << std::endl;
+            return -1;
         }
     }
     printf("Done!\n");
@@ -66,7 +45,7 @@ int main() {
     PMSOption psmOption;
     // patch大小
     psmOption._patchSize = 35;
-    // 候选视差范围
+    // 候选视差范围（各像对由d_range.txt指定）
     psmOption._minDisparity = 0;
     psmOption._maxDisparity = 64;
     // gamma
@@ -77,53 +56,84 @@ int main() {
     psmOption._tauCol = 10.0f;
     // t_grad
     psmOption._tauGrad = 2.0f;
+    // 代价类型
+    psmOption._costType = PMS_COST_PMS;
     // 传播迭代次数
     psmOption._numIters = 3;
+    // 金字塔层数及粗层迭代次数
+    psmOption._numPyramidLevels = 1;
+    psmOption._numCoarseIters = 3;
     // 前端平行窗口
     psmOption._isForceFpw = false;
     // 整数视差精度
     psmOption._isIntegerDisp = false;
+    // 整数视差代价体（前端平行窗口且整数视差时生效）
+    psmOption._isUseCostVolume = false;
+    // 只计算左视图（开启后不做一致性检查，不输出右视差图）
+    psmOption._isLeftOnly = false;
     // 一致性检查
     psmOption._isCheckLR = true;
     psmOption._lrCheckThres = 1.0f;
     // 视差图填充
     psmOption._isFillHoles = true;
+    // 红黑棋盘格并行传播及线程数
+    psmOption._isCheckerboard = true;
+    psmOption._numThreads = 0;
+    // SIMD聚合核
+    psmOption._isUseSimd = true;
+    // 不保留灰度图
+    psmOption._isKeepGray = false;
+    // 随机种子
+    psmOption._seed = 0;
+    // 支持权值缓存
+    psmOption._isUseWeightCache = false;
+    psmOption._weightCacheThres = 0.01f;
+    // 右影像亚像素预插值细分数（0为逐点插值）
+    psmOption._subpixelStep = 0;
+    // 活动集传播及提前结束阈值
+    psmOption._isUseActiveSet = false;
+    psmOption._activeSetThres = 0.0f;
+    // 视频模式：每帧随机初始化比例及传播迭代次数
+    psmOption._temporalRandomRatio = 0.1f;
+    psmOption._numTemporalIters = 1;
 
-    PatchMatchStereo pms;
-    // 初始化
-    if (!pms.initialize(width, height, psmOption)) {
-        std::cout << "PMS Initialization Failure!" << std::endl;
-        return -2;
-    }
-
-    // 匹配
-    auto *disLeft = new float32[width * height];
-    auto *disRight = new float32[width * height];
-    if (!pms.match(bytesLeft, bytesRight, disLeft, disRight)) {
-        std::cout << "PMS Matching Failure!" << std::endl;
-        return -2;
-    }
+    // ··· 批量匹配：各像对分配给固定数量的匹配实例并行处理
+    PMSBatchMatcher matcher(psmOption);
+    const auto results = matcher.match(items);
 
     // 显示视差图
-    cv::Mat dispMatLeft = cv::Mat(height, width, CV_8UC1);
-    cv::Mat dispMatRight = cv::Mat(height, width, CV_8UC1);
-    cv::Mat dispMat = cv::Mat(height, width * 2, CV_8UC1);
+    for (size_t n = 0; n < items.size(); n++) {
+        const auto &result = results[n];
+        if (!result._isSuccess) {
+            std::cout << "PMS Matching Failure: " << dataSets[n][0] << std::endl;
+            return -2;
+        }
+        const sint32 width = items[n]._width;
+        const sint32 height = items[n]._height;
 
-    dispMatNorm(width, height, disLeft, dispMatLeft);
-    dispMatNorm(width, height, disRight, dispMatRight);
-    cv::hconcat(dispMatLeft, dispMatRight, dispMat);
+        cv::Mat dispMatLeft = cv::Mat(height, width, CV_8UC1);
+        cv::Mat dispMatRight = cv::Mat(height, width, CV_8UC1);
+        cv::Mat dispMat = cv::Mat(height, width * 2, CV_8UC1);
 
-    cv::imwrite("../dispMatLeft.png", dispMatLeft);
-    cv::imshow("dispMatLeft", dispMatLeft);
-    cv::imwrite("../dispMatRight.png", dispMatRight);
-    cv::imshow("dispMatRight", dispMatRight);
-    cv::imshow("dispMat", dispMat);
-    cv::waitKey(0);
+        dispMatNorm(width, height, result._dispLeft.data(), dispMatLeft);
+        if (!result._dispRight.empty()) {
+            dispMatNorm(width, height, result._dispRight.data(), dispMatRight);
+        } else {
+            dispMatRight.setTo(0);
+        }
+        cv::hconcat(dispMatLeft, dispMatRight, dispMat);
 
-    delete[] disLeft;
-    delete[] disRight;
-    disLeft = nullptr;
-    disRight = nullptr;
+        const std::string &name = dataSets[n][0];
+        cv::imwrite("../dispMatLeft_" + name + ".png", dispMatLeft);
+        cv::imwrite("../dispMatRight_" + name + ".png", dispMatRight);
+        // 保留亚像素精度的浮点视差图
+        writePfm("../dispLeft_" + name + ".pfm", result._dispLeft.data(), width, height);
+        if (!result._dispRight.empty()) {
+            writePfm("../dispRight_" + name + ".pfm", result._dispRight.data(), width, height);
+        }
+        cv::imshow("dispMat_" + name, dispMat);
+    }
+    cv::waitKey(0);
 
     return 0;
 }
@@ -0,0 +1,382 @@
+//
+// Created by tianhe on 2022/9/19.
+//
+
+/**
+ * 内核微基准测试：在合成影像及data目录下的Middlebury像对上，分别测试代价计算、代价聚合、
+ * 双线性插值取色/取梯度、平面优化及空间传播各内核，输出每次调用耗时(ns)及每秒代价计算次数。
+ *
+ * 用法: PatchMatchMicroBenchmark [--data 目录] [--patches 11,21,35] [--samples N] [--no-simd]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "PMSType.h"
+#include "PMSBatch.h"
+#include "PMSImageUtil.h"
+#include "PatchMatchStereo.h"
+#include "PMSPreprocess.h"
+
+/** \brief 每项测试的最短耗时（秒），调用次数逐次加倍直至满足 */
+static const float64 MIN_SECONDS = 0.2;
+
+/** \brief 防止测试结果被编译器优化掉 */
+static volatile float32 g_sink = 0.0f;
+
+/**
+ * \brief 测量函数的平均调用耗时
+ * \param func 被测函数，参数为调用序号
+ * \param numCalls 输出，各轮累计调用次数
+ * \return 最后一轮中每次调用耗时（纳秒）
+ */
+template<typename Func>
+static float64 measure(Func &&func, uint64 &numCalls) {
+    numCalls = 0;
+    for (uint64 n = 1;; n *= 2) {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64 i = 0; i < n; i++) {
+            func(numCalls + i);
+        }
+        const float64 seconds = std::chrono::duration<float64>(std::chrono::steady_clock::now() - start).count();
+        numCalls += n;
+        if (seconds >= MIN_SECONDS || n >= (uint64(1) << 32)) {
+            return seconds * 1e9 / float64(n);
+        }
+    }
+}
+
+/** \brief 输出一行测试结果 */
+static void report(const std::string &image, const std::string &kernel, const sint32 &patchSize,
+                   const float64 &nsPerCall, const float64 &evalsPerCall) {
+    printf("%-10s %-38s %6d %14.1f %16.0f\n", image.c_str(), kernel.c_str(), patchSize,
+           nsPerCall, evalsPerCall * 1e9 / nsPerCall);
+}
+
+/**
+ * \brief 微基准测试：持有一对影像的梯度及初始平面，逐项测试各内核
+ * 初始平面取自不迭代（_numIters为0）的一次完整匹配，只通过匹配实例及传播实例的公开接口调用
+ */
+class PMSMicroBenchmark {
+public:
+    PMSMicroBenchmark(const std::string &name, const sint32 &width, const sint32 &height,
+                      const uint8 *imgLeft, const uint8 *imgRight, const PMSOption &option,
+                      const sint32 &numSamples)
+            : _name(name), _width(width), _height(height), _imgLeft(imgLeft), _imgRight(imgRight),
+              _option(option), _numSamples(numSamples) {}
+
+    /**
+     * \brief 以指定Patch尺寸运行全部测试
+     * \param patchSize Patch尺寸
+     */
+    void run(const sint32 &patchSize) {
+        _option._patchSize = patchSize;
+
+        // 不迭代的匹配只做随机初始化，其平面场即为初始平面；传播步骤会修改平面，故复制一份
+        PMSOption optionInit = _option;
+        optionInit._numIters = 0;
+        optionInit._numPyramidLevels = 1;
+        optionInit._isLeftOnly = false;
+        optionInit._isCheckLR = false;
+        optionInit._isFillHoles = false;
+        if (!_pms.initialize(_width, _height, optionInit) || !_pms.match(_imgLeft, _imgRight, nullptr, nullptr)) {
+            fprintf(stderr, "initialization failed: %s\n", _name.c_str());
+            return;
+        }
+        const size_t size = size_t(_width) * size_t(_height);
+        _planeLeft.assign(_pms.getDisparityPlanes(0), _pms.getDisparityPlanes(0) + size);
+        _planeRight.assign(_pms.getDisparityPlanes(1), _pms.getDisparityPlanes(1) + size);
+        _costLeft.assign(size, 0.0f);
+        _costRight.assign(size, 0.0f);
+        _dispLeft.assign(size, 0.0f);
+
+        // 梯度与匹配流程相同，由预处理函数计算
+        _gradLeft.resize(size);
+        _gradRight.resize(size);
+        computeGradientBand(_imgLeft, _width, _height, 0, _height, _gradLeft.data(), nullptr, nullptr,
+                            _option._isUseSimd);
+        computeGradientBand(_imgRight, _width, _height, 0, _height, _gradRight.data(), nullptr, nullptr,
+                            _option._isUseSimd);
+
+        // 测试像素：随机选取，远离边界以免窗口越界的分支影响计时
+        const sint32 border = std::min(patchSize / 2, std::min(_width, _height) / 4);
+        PMSRandom rng(_option._seed, PMSRandom::makeKey(uint32(patchSize), 0));
+        _samples.resize(_numSamples);
+        for (auto &sample: _samples) {
+            sample.first = border + sint32(rng.uniform(0.0f, 1.0f) * float32(_width - 2 * border - 1));
+            sample.second = border + sint32(rng.uniform(0.0f, 1.0f) * float32(_height - 2 * border - 1));
+        }
+
+        if (patchSize == 21) {
+            runKernels<21>();
+        } else if (patchSize == 35) {
+            runKernels<35>();
+        } else {
+            runKernels<0>();
+        }
+    }
+
+private:
+    template<sint32 PatchSize>
+    void runKernels() {
+        const sint32 patchSize = _option._patchSize;
+        const sint32 width = _width;
+        CostComputerPMS costCpt(_imgLeft, _imgRight, _gradLeft.data(), _gradRight.data(), _width, _height,
+                                patchSize, _option._minDisparity, _option._maxDisparity,
+                                _option._gamma, _option._alpha, _option._tauCol, _option._tauGrad);
+        costCpt.setUseSimd(_option._isUseSimd);
+        const sint32 numDisparities = std::max(1, _option._maxDisparity - _option._minDisparity);
+        uint64 numCalls = 0;
+
+        // 单像素代价
+        float64 ns = measure([&](const uint64 &i) {
+            const auto &sample = _samples[i % _samples.size()];
+            const float32 d = float32(_option._minDisparity + sint32(i % numDisparities)) + 0.5f;
+            g_sink = g_sink + costCpt.compute(sample.first, sample.second, d);
+        }, numCalls);
+        report(_name, "CostComputerPMS::compute", patchSize, ns, 1.0);
+
+        // 双线性插值取色、取梯度
+        ns = measure([&](const uint64 &i) {
+            const auto &sample = _samples[i % _samples.size()];
+            const auto col = costCpt.getColor(_imgRight, float32(sample.first) + 0.37f, sample.second);
+            g_sink = g_sink + col._x;
+        }, numCalls);
+        report(_name, "CostComputerPMS::getColor(float)", patchSize, ns, 1.0);
+        ns = measure([&](const uint64 &i) {
+            const auto &sample = _samples[i % _samples.size()];
+            const auto grad = costCpt.getGradient(_gradRight.data(), float32(sample.first) + 0.37f, sample.second);
+            g_sink = g_sink + grad._x;
+        }, numCalls);
+        report(_name, "CostComputerPMS::getGradient(float)", patchSize, ns, 1.0);
+
+        // 灰度及梯度预处理：每次调用处理整幅左影像
+        std::vector<PGradient> grad(size_t(_width) * _height);
+        ns = measure([&](const uint64 &) {
+            computeGradientBand(_imgLeft, _width, _height, 0, _height, grad.data(), nullptr, nullptr,
+                                _option._isUseSimd);
+            g_sink = g_sink + grad[size_t(_height / 2) * _width + _width / 2]._x;
+        }, numCalls);
+        report(_name, "computeGradientBand", patchSize, ns, float64(_width) * float64(_height));
+
+        // 代价聚合：运行期Patch尺寸及编译期特化尺寸
+        ns = measure([&](const uint64 &i) {
+            const auto &sample = _samples[i % _samples.size()];
+            const auto &plane = _planeLeft[sample.second * width + sample.first];
+            g_sink = g_sink + costCpt.computeAggregation(sample.first, sample.second, plane);
+        }, numCalls);
+        report(_name, "CostComputerPMS::computeAggregation", patchSize, ns, 1.0);
+        if (PatchSize > 0) {
+            ns = measure([&](const uint64 &i) {
+                const auto &sample = _samples[i % _samples.size()];
+                const auto &plane = _planeLeft[sample.second * width + sample.first];
+                g_sink = g_sink + costCpt.template computeAggregation<PatchSize>(sample.first, sample.second, plane);
+            }, numCalls);
+            report(_name, "CostComputerPMS::computeAggregation<P>", patchSize, ns, 1.0);
+        }
+
+        // Census代价聚合：Census编码与匹配流程相同，随梯度一并计算
+        std::vector<uint64> censusLeft(size_t(_width) * _height);
+        std::vector<uint64> censusRight(size_t(_width) * _height);
+        computeGradientBand(_imgLeft, _width, _height, 0, _height, grad.data(), nullptr, censusLeft.data(),
+                            _option._isUseSimd);
+        computeGradientBand(_imgRight, _width, _height, 0, _height, grad.data(), nullptr, censusRight.data(),
+                            _option._isUseSimd);
+        CostComputerCensus censusCpt(_imgLeft, _imgRight, censusLeft.data(), censusRight.data(), _width, _height,
+                                     patchSize, _option._minDisparity, _option._maxDisparity,
+                                     _option._gamma, _option._alpha, _option._tauCol, _option._tauGrad);
+        censusCpt.setUseSimd(_option._isUseSimd);
+        ns = measure([&](const uint64 &i) {
+            const auto &sample = _samples[i % _samples.size()];
+            const auto &plane = _planeLeft[sample.second * width + sample.first];
+            g_sink = g_sink + censusCpt.template computeAggregation<PatchSize>(sample.first, sample.second, plane);
+        }, numCalls);
+        report(_name, "CostComputerCensus::computeAggregation<P>", patchSize, ns, 1.0);
+
+        // 传播步骤：构造传播实例（计算初始代价），逐像素调用
+        typedef PMSPolicy<CostComputerPMS, PatchSize, false, false> Policy;
+        PMSCostInput inputLeft;
+        inputLeft._imgLeft = _imgLeft;
+        inputLeft._imgRight = _imgRight;
+        inputLeft._gradLeft = _gradLeft.data();
+        inputLeft._gradRight = _gradRight.data();
+        inputLeft._width = _width;
+        inputLeft._height = _height;
+        inputLeft._minDisparity = _option._minDisparity;
+        inputLeft._maxDisparity = _option._maxDisparity;
+        PMSCostInput inputRight = inputLeft;
+        std::swap(inputRight._imgLeft, inputRight._imgRight);
+        std::swap(inputRight._gradLeft, inputRight._gradRight);
+        inputRight._minDisparity = -_option._maxDisparity;
+        inputRight._maxDisparity = -_option._minDisparity;
+        typedef PMSPropagation<Policy> Propagation;
+        Propagation propagation(_option, inputLeft, inputRight,
+                                _planeLeft.data(), _planeRight.data(),
+                                _costLeft.data(), _costRight.data(), _dispLeft.data());
+        PMSStatistics stats;
+        ns = measure([&](const uint64 &i) {
+            const auto &sample = _samples[i % _samples.size()];
+            propagation.doPixelStep(Propagation::PixelStep::PlaneRefine, sample.first, sample.second, 0, stats);
+        }, numCalls);
+        report(_name, "PMSPropagation::planeRefine", patchSize, ns,
+               float64(stats._numEvaluations) / float64(numCalls));
+
+        stats = PMSStatistics();
+        ns = measure([&](const uint64 &i) {
+            const auto &sample = _samples[i % _samples.size()];
+            propagation.doPixelStep(Propagation::PixelStep::SpatialPropagation, sample.first, sample.second,
+                                    (i % 2 == 0) ? 1 : -1, stats);
+        }, numCalls);
+        report(_name, "PMSPropagation::spatialPropagation", patchSize, ns,
+               float64(stats._numEvaluations) / float64(numCalls));
+    }
+
+    std::string _name;
+    sint32 _width;
+    sint32 _height;
+    const uint8 *_imgLeft;
+    const uint8 *_imgRight;
+    PMSOption _option;
+    sint32 _numSamples;
+
+    PatchMatchStereo _pms;
+    std::vector<PGradient> _gradLeft;
+    std::vector<PGradient> _gradRight;
+    std::vector<DisparityPlane> _planeLeft;
+    std::vector<DisparityPlane> _planeRight;
+    std::vector<float32> _costLeft;
+    std::vector<float32> _costRight;
+    std::vector<float32> _dispLeft;
+    std::vector<std::pair<sint32, sint32>> _samples;
+};
+
+/** \brief 生成合成像对：平滑随机纹理，右影像为左影像整体平移亚像素视差 */
+static void makeSynthetic(const sint32 &width, const sint32 &height, const float32 &disparity,
+                          std::vector<uint8> &imgLeft, std::vector<uint8> &imgRight) {
+    const sint32 widthExt = width + sint32(std::ceil(disparity)) + 1;
+    std::vector<float32> texture(size_t(widthExt) * height * 3);
+    PMSRandom rng(1, 0);
+    for (auto &t: texture) {
+        t = rng.uniform(0.0f, 255.0f);
+    }
+    // 3x3均值平滑，使梯度分布接近自然影像
+    std::vector<float32> smooth(texture.size());
+    for (sint32 y = 0; y < height; y++) {
+        for (sint32 x = 0; x < widthExt; x++) {
+            for (sint32 n = 0; n < 3; n++) {
+                float32 sum = 0.0f;
+                sint32 count = 0;
+                for (sint32 dy = -1; dy <= 1; dy++) {
+                    for (sint32 dx = -1; dx <= 1; dx++) {
+                        const sint32 yy = y + dy, xx = x + dx;
+                        if (yy >= 0 && yy < height && xx >= 0 && xx < widthExt) {
+                            sum += texture[(size_t(yy) * widthExt + xx) * 3 + n];
+                            count++;
+                        }
+                    }
+                }
+                smooth[(size_t(y) * widthExt + x) * 3 + n] = sum / float32(count);
+            }
+        }
+    }
+
+    // 左影像(x) = 纹理(x)，右影像(x) = 纹理(x + d)，即左影像(x) = 右影像(x - d)
+    imgLeft.resize(size_t(width) * height * 3);
+    imgRight.resize(size_t(width) * height * 3);
+    const auto x0 = sint32(disparity);
+    const float32 ofs = disparity - float32(x0);
+    for (sint32 y = 0; y < height; y++) {
+        const float32 *row = &smooth[size_t(y) * widthExt * 3];
+        for (sint32 x = 0; x < width; x++) {
+            for (sint32 n = 0; n < 3; n++) {
+                imgLeft[(size_t(y) * width + x) * 3 + n] = uint8(row[x * 3 + n]);
+                imgRight[(size_t(y) * width + x) * 3 + n] =
+                        uint8((1.0f - ofs) * row[(x + x0) * 3 + n] + ofs * row[(x + x0 + 1) * 3 + n]);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    // ··· 参数
+    std::string dataDir = "../data";
+    std::vector<sint32> patchSizes = {11, 21, 35};
+    sint32 numSamples = 4096;
+    PMSOption option;
+    option._numThreads = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--data" && hasValue) {
+            dataDir = argv[++i];
+        } else if (arg == "--patches" && hasValue) {
+            patchSizes.clear();
+            std::stringstream ss(argv[++i]);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                patchSizes.push_back(std::atoi(item.c_str()));
+            }
+        } else if (arg == "--samples" && hasValue) {
+            numSamples = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--no-simd") {
+            option._isUseSimd = false;
+        } else {
+            fprintf(stderr, "unknown argument: %s\n", arg.c_str());
+            return -1;
+        }
+    }
+
+    printf("%-10s %-38s %6s %14s %16s\n", "image", "kernel", "patch", "ns/call", "evals/sec");
+
+    // ··· 合成影像
+    {
+        std::vector<uint8> imgLeft, imgRight;
+        const sint32 width = 320, height = 240;
+        makeSynthetic(width, height, 10.5f, imgLeft, imgRight);
+        PMSOption optionSyn = option;
+        optionSyn._minDisparity = 0;
+        optionSyn._maxDisparity = 32;
+        PMSMicroBenchmark bench("synthetic", width, height, imgLeft.data(), imgRight.data(), optionSyn, numSamples);
+        for (const auto &patchSize: patchSizes) {
+            bench.run(patchSize);
+        }
+    }
+
+    // ··· 数据集：名称、左影像、右影像
+    const std::vector<std::vector<std::string>> dataSets = {
+            {"Cone", "im2.png", "im6.png"},
+            {"Piano", "im0.png", "im1.png"},
+            {"Reindeer", "view1.png", "view5.png"}
+    };
+    for (const auto &dataSet: dataSets) {
+        const std::string dir = dataDir + "/" + dataSet[0];
+        std::vector<uint8> imgLeft, imgRight;
+        sint32 width = 0, height = 0, widthRight = 0, heightRight = 0;
+        if (!loadImage(dir + "/" + dataSet[1], imgLeft, width, height) ||
+            !loadImage(dir + "/" + dataSet[2], imgRight, widthRight, heightRight) ||
+            width != widthRight || height != heightRight) {
+            fprintf(stderr, "failed to read images: %s\n", dir.c_str());
+            continue;
+        }
+        PMSOption optionPair = option;
+        if (!PMSBatchMatcher::loadDisparityRange(dir + "/d_range.txt",
+                                                 optionPair._minDisparity, optionPair._maxDisparity)) {
+            fprintf(stderr, "failed to read disparity range: %s\n", dir.c_str());
+            continue;
+        }
+        PMSMicroBenchmark bench(dataSet[0], width, height, imgLeft.data(), imgRight.data(), optionPair, numSamples);
+        for (const auto &patchSize: patchSizes) {
+            bench.run(patchSize);
+        }
+    }
+
+    return 0;
+}